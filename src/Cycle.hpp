@@ -7,6 +7,8 @@
 #ifndef _POWERDXX_TIMING_CYCLE_HPP_
 #define _POWERDXX_TIMING_CYCLE_HPP_
 
+#include "sys/event.hpp"  /* sys::event::Reactor */
+
 #include <chrono>    /* std::chrono::steady_clock::now() */
 #include <unistd.h>  /* usleep() */
 
@@ -75,11 +77,47 @@ namespace timing {
  * }
  * ~~~
  *
+ * Instead of sleeping the cycle can wait on a sys::event::Reactor,
+ * which reports signals and other inputs synchronously. After
+ * handling an event the cycle is completed by waiting again without
+ * a cycle time:
+ *
+ * ~~~ c++
+ * sys::event::Reactor reactor;
+ * sys::sig::Signal sigterm{SIGTERM, reactor};
+ * timing::Cycle sleep;
+ * for (auto ev = sleep(reactor, ival);
+ *      ev.what != sys::event::type::signal;) {
+ *	if (ev.what != sys::event::type::timeout) {
+ *		…handle input…
+ *		ev = sleep(reactor);
+ *		continue;
+ *	}
+ * 	…do stuff…
+ *	ev = sleep(reactor, ival);
+ * }
+ * ~~~
+ *
  * Note there was a design decision between providing a cycle time
  * to the constructor or providing it every cycle. The latter was
  * chosen so the cycle time can be adjusted.
+ *
+ * If a cycle overruns its deadline, e.g. because the system was
+ * suspended, the catchup policy determines how the missed cycles
+ * are treated. The actual duration of the last completed cycle is
+ * available via elapsed().
  */
 class Cycle {
+	public:
+	/**
+	 * The policies for treating missed deadlines.
+	 */
+	enum class catchup {
+		burst,    /**< Complete all missed cycles without waiting */
+		skip,     /**< Skip missed cycles, keep the rhythm */
+		reanchor  /**< Restart the rhythm from the overrun */
+	};
+
 	private:
 	/**
 	 * Use steady_clock, avoid time jumps.
@@ -96,7 +134,83 @@ class Cycle {
 	 */
 	std::chrono::time_point<clock> clk = clock::now();
 
+	/**
+	 * The time the last cycle was completed.
+	 */
+	std::chrono::time_point<clock> done = clk;
+
+	/**
+	 * The actual duration of the last completed cycle.
+	 */
+	us last{0};
+
+	/**
+	 * The policy for missed deadlines.
+	 */
+	catchup const policy;
+
+	/**
+	 * Advance the deadline by a cycle time.
+	 *
+	 * @param cycleTime
+	 *	The duration of the cycle
+	 */
+	void advance(clock::duration const cycleTime) {
+		this->clk += cycleTime;
+		if (this->policy == catchup::burst ||
+		    cycleTime <= clock::duration::zero()) {
+			return;
+		}
+		auto const now = clock::now();
+		if (this->clk >= now) {
+			return;
+		}
+		switch (this->policy) {
+		case catchup::burst:
+			break;
+		case catchup::skip:
+			this->clk += ((now - this->clk) / cycleTime + 1) *
+			             cycleTime;
+			break;
+		case catchup::reanchor:
+			this->clk = now + cycleTime;
+			break;
+		}
+	}
+
+	/**
+	 * Record the completion of a cycle.
+	 */
+	void complete() {
+		auto const now = clock::now();
+		this->last = std::chrono::duration_cast<us>(now - this->done);
+		this->done = now;
+	}
+
 	public:
+	/**
+	 * Construct a cycle.
+	 *
+	 * @param policy
+	 *	The policy for missed deadlines
+	 */
+	explicit Cycle(catchup const policy = catchup::burst) :
+	    policy{policy} {}
+
+	/**
+	 * Returns the actual duration of the last completed cycle.
+	 *
+	 * This is the time between the completion of the last two
+	 * cycles, or the construction of the cycle and the first
+	 * completed cycle.
+	 *
+	 * @return
+	 *	The duration in microseconds
+	 */
+	us elapsed() const {
+		return this->last;
+	}
+
 	/**
 	 * Completes an interrupted sleep cycle.
 	 *
@@ -109,12 +223,16 @@ class Cycle {
 	 * @retval false
 	 *	Sleep was interrupted
 	 */
-	bool operator ()() const {
+	bool operator ()() {
 		auto const remainingTime{
 			std::chrono::duration_cast<us>(this->clk - clock::now())
 		};
 		auto const sleepDuration = remainingTime.count();
-		return sleepDuration <= 0 || 0 == usleep(sleepDuration);
+		if (sleepDuration <= 0 || 0 == usleep(sleepDuration)) {
+			complete();
+			return true;
+		}
+		return false;
 	}
 
 	/**
@@ -136,10 +254,49 @@ class Cycle {
 	 */
 	template <class... DurTraits>
 	bool operator ()(std::chrono::duration<DurTraits...> const & cycleTime) {
-		this->clk += cycleTime;
+		advance(std::chrono::duration_cast<clock::duration>(cycleTime));
 		return (*this)();
 	}
 
+	/**
+	 * Completes an interrupted cycle, waiting for events.
+	 *
+	 * @param reactor
+	 *	The reactor to wait on
+	 * @return
+	 *	The event ending the wait, sys::event::type::timeout
+	 *	if the cycle was completed
+	 */
+	sys::event::Event operator ()(sys::event::Reactor & reactor) {
+		auto const ev = reactor.wait(this->clk);
+		if (ev.what == sys::event::type::timeout) {
+			complete();
+		}
+		return ev;
+	}
+
+	/**
+	 * Wait for the time required to complete the given cycle time
+	 * or an event.
+	 *
+	 * @tparam DurTraits
+	 *	The traits of the duration type
+	 * @param reactor
+	 *	The reactor to wait on
+	 * @param cycleTime
+	 *	The duration of the cycle to complete
+	 * @return
+	 *	The event ending the wait, sys::event::type::timeout
+	 *	if the cycle was completed
+	 */
+	template <class... DurTraits>
+	sys::event::Event
+	operator ()(sys::event::Reactor & reactor,
+	            std::chrono::duration<DurTraits...> const & cycleTime) {
+		advance(std::chrono::duration_cast<clock::duration>(cycleTime));
+		return (*this)(reactor);
+	}
+
 };
 
 } /* namespace timing */
@@ -0,0 +1,499 @@
+/**
+ * Implements the powerd++ journal format.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_JOURNAL_HPP_
+#define _POWERDXX_JOURNAL_HPP_
+
+#include "sys/error.hpp"  /* sys::sc_error */
+#include "sys/io.hpp"     /* sys::io::file */
+
+#include <string>         /* std::string */
+#include <vector>         /* std::vector */
+#include <cstdint>        /* uint64_t, uint32_t, uint16_t, uint8_t */
+#include <cstdio>         /* rename() */
+#include <cstring>        /* memcpy(), memcmp() */
+#include <cerrno>         /* errno, ENOENT */
+#include <utility>        /* std::move() */
+
+/**
+ * Namespace for the powerd++ journal.
+ *
+ * The journal records the inputs and decisions of every powerd++
+ * cycle, so a misbehaving daemon can be reproduced offline.
+ *
+ * A journal file consists of a header followed by records. The
+ * header is followed by the core group of every core, the
+ * controlling core of every core group and two text blocks, the
+ * load recording header of the system and the command line.
+ *
+ * Each record is prefixed with its length in bytes. All record
+ * values are unsigned integers in LEB128 encoding, i.e. 7 bits
+ * per byte, least significant group first, with the high bit
+ * set in all but the last byte:
+ *
+ * | Values        | Count              | Description                 |
+ * |---------------|--------------------|-----------------------------|
+ * | duration      | 1                  | µs since the previous cycle |
+ * | acline        | 1                  | hw.acpi.acline              |
+ * | freq          | 1 per group        | dev.cpu.%d.freq             |
+ * | temperature   | 1 per group        | dK, 0 without TEMPERATURE   |
+ * | decision      | 1 per group        | The selected clock in MHz   |
+ * | ticks         | states per core    | kern.cp_times growth        |
+ */
+namespace journal {
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * Identifies a journal file.
+ */
+char const MAGIC[8]{'p', 'd', '+', '+', 'j', 'r', 'n', 'l'};
+
+/**
+ * The journal format version.
+ */
+uint32_t const VERSION{1};
+
+/**
+ * Header flags.
+ */
+enum flag : uint32_t {
+	TEMPERATURE = 0x01, /**< The group temperatures are tracked */
+	START       = 0x02, /**< The file starts a run, the first record
+	                         contains absolute kern.cp_times values */
+};
+
+/**
+ * The journal file header.
+ *
+ * All values are in host byte order.
+ */
+struct Header {
+	/**
+	 * Must be MAGIC.
+	 */
+	char magic[8];
+
+	/**
+	 * Must be VERSION.
+	 */
+	uint32_t version;
+
+	/**
+	 * A combination of header flags.
+	 */
+	uint32_t flags;
+
+	/**
+	 * The number of cores.
+	 */
+	uint16_t ncpu;
+
+	/**
+	 * The number of core groups.
+	 */
+	uint16_t ngroups;
+
+	/**
+	 * The number of kern.cp_times columns per core.
+	 */
+	uint16_t states;
+
+	/**
+	 * Reserved, must be 0.
+	 */
+	uint16_t reserved;
+
+	/**
+	 * The length of the load recording header text.
+	 */
+	uint32_t sysctls;
+
+	/**
+	 * The length of the command line text.
+	 */
+	uint32_t args;
+};
+
+static_assert(sizeof(Header) == 32, "the header layout must be packed");
+
+/**
+ * Append an integer in LEB128 encoding.
+ *
+ * @param dst
+ *	The buffer to append to
+ * @param value
+ *	The value to encode
+ */
+inline void put(std::vector<uint8_t> & dst, uint64_t value) {
+	for (; value >= 0x80; value >>= 7) {
+		dst.push_back(uint8_t(value | 0x80));
+	}
+	dst.push_back(uint8_t(value));
+}
+
+/**
+ * Decode an integer in LEB128 encoding.
+ *
+ * @param it
+ *	The read position, advanced behind the value
+ * @param end
+ *	The end of the buffer
+ * @param value
+ *	The value to decode into
+ * @return
+ *	Whether a complete value was decoded
+ */
+inline bool get(uint8_t const *& it, uint8_t const * const end,
+                uint64_t & value) {
+	value = 0;
+	for (unsigned shift = 0; it < end && shift < 64; shift += 7) {
+		auto const byte = *it++;
+		value |= uint64_t{byte & 0x7fu} << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Serialise a journal file header.
+ *
+ * @param head
+ *	The header, the magic, version and text lengths are filled in
+ * @param groups
+ *	The core group of every core
+ * @param corei
+ *	The controlling core of every core group
+ * @param sysctls
+ *	The load recording header text
+ * @param args
+ *	The command line
+ * @return
+ *	The header bytes
+ */
+inline std::vector<uint8_t>
+serialise(Header head, std::vector<uint16_t> const & groups,
+          std::vector<uint16_t> const & corei,
+          std::string const & sysctls, std::string const & args) {
+	std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+	head.version = VERSION;
+	head.reserved = 0;
+	head.sysctls = sysctls.size();
+	head.args = args.size();
+	std::vector<uint8_t> result(sizeof(head));
+	std::memcpy(result.data(), &head, sizeof(head));
+	for (auto const & list : {groups, corei}) {
+		auto const bytes =
+		    reinterpret_cast<uint8_t const *>(list.data());
+		result.insert(result.end(), bytes,
+		              bytes + list.size() * sizeof(uint16_t));
+	}
+	result.insert(result.end(), sysctls.begin(), sysctls.end());
+	result.insert(result.end(), args.begin(), args.end());
+	return result;
+}
+
+/**
+ * Appends records to a journal file with rotation.
+ *
+ * When the file grows beyond its size limit it is renamed by
+ * appending `.0` to the path, replacing the previous generation,
+ * and a new file is started. Every file starts with the header,
+ * so it can be converted on its own. Only the first file of a
+ * run carries the START flag.
+ */
+class Writer {
+	private:
+	/**
+	 * The journal file.
+	 */
+	sys::io::file<sys::io::own, sys::io::write> file;
+
+	/**
+	 * The journal path.
+	 */
+	std::string const path;
+
+	/**
+	 * The size limit in bytes.
+	 */
+	size_t const limit;
+
+	/**
+	 * The number of bytes in the current file.
+	 */
+	size_t size{0};
+
+	/**
+	 * The serialised header.
+	 */
+	std::vector<uint8_t> const head;
+
+	/**
+	 * The record under construction.
+	 */
+	std::vector<uint8_t> record;
+
+	/**
+	 * The length prefixed record.
+	 */
+	std::vector<uint8_t> frame;
+
+	/**
+	 * Move the current file to the previous generation and
+	 * start a new file.
+	 *
+	 * The current file remains open if this fails.
+	 *
+	 * @param start
+	 *	Whether the new file starts a run
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of rename() or fopen()
+	 */
+	void rotate(bool const start) {
+		if (0 != std::rename(this->path.c_str(),
+		                     (this->path + ".0").c_str()) &&
+		    errno != ENOENT) {
+			throw sys::sc_error<error>{errno};
+		}
+		sys::io::file<sys::io::own, sys::io::write>
+		    file{this->path.c_str(), "wb"};
+		if (!file) {
+			throw sys::sc_error<error>{errno};
+		}
+		Header head;
+		std::memcpy(&head, this->head.data(), sizeof(head));
+		head.flags = start ? head.flags | START : head.flags & ~START;
+		file.write(head);
+		file.write(this->head.data() + sizeof(head),
+		           this->head.size() - sizeof(head));
+		this->file = std::move(file);
+		this->size = this->head.size();
+	}
+
+	public:
+	/**
+	 * Start a new journal.
+	 *
+	 * An existing journal at the given path is rotated, so the
+	 * journal of a previous run is preserved.
+	 *
+	 * @param path
+	 *	The journal path
+	 * @param limit
+	 *	The size limit in bytes
+	 * @param head
+	 *	The serialised header
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of rename() or fopen()
+	 */
+	Writer(char const * const path, size_t const limit,
+	       std::vector<uint8_t> && head) :
+	    path{path}, limit{limit}, head{std::move(head)} {
+		rotate(true);
+	}
+
+	/**
+	 * Append a value to the current record.
+	 *
+	 * @param value
+	 *	The value to append
+	 * @return
+	 *	A self reference
+	 */
+	Writer & operator <<(uint64_t const value) {
+		put(this->record, value);
+		return *this;
+	}
+
+	/**
+	 * Write the current record and start a new one.
+	 *
+	 * The record is written with a single call and flushed, so
+	 * the journal is complete up to the last cycle if the daemon
+	 * is killed. Write errors are ignored.
+	 */
+	void commit() {
+		this->frame.clear();
+		put(this->frame, this->record.size());
+		this->frame.insert(this->frame.end(), this->record.begin(),
+		                   this->record.end());
+		this->record.clear();
+		this->file.write(this->frame.data(), this->frame.size());
+		this->file.flush();
+		this->size += this->frame.size();
+		if (this->size >= this->limit) try {
+			rotate(false);
+		} catch (sys::sc_error<error>) {
+			/* keep writing to the current file */
+		}
+	}
+};
+
+/**
+ * A read-only view of a mapped journal file.
+ */
+class Reader {
+	private:
+	/**
+	 * The mapped journal file.
+	 */
+	sys::io::mapping map;
+
+	/**
+	 * The header, nullptr for an invalid journal.
+	 */
+	Header const * head{nullptr};
+
+	/**
+	 * The read position.
+	 */
+	uint8_t const * it{nullptr};
+
+	/**
+	 * The end of the current record.
+	 */
+	uint8_t const * eor{nullptr};
+
+	/**
+	 * Returns the end of the mapping.
+	 *
+	 * @return
+	 *	A pointer behind the last byte
+	 */
+	uint8_t const * end() const {
+		return reinterpret_cast<uint8_t const *>(this->map.end());
+	}
+
+	public:
+	/**
+	 * Take ownership of a mapped journal file.
+	 *
+	 * @param map
+	 *	The mapped journal file
+	 */
+	explicit Reader(sys::io::mapping && map) : map{std::move(map)} {
+		auto const head =
+		    reinterpret_cast<Header const *>(this->map.begin());
+		if (!this->map || this->map.size() < sizeof(Header) ||
+		    0 != std::memcmp(head->magic, MAGIC, sizeof(MAGIC)) ||
+		    head->version != VERSION ||
+		    this->map.size() < sizeof(Header) +
+		                       (size_t{head->ncpu} + head->ngroups) *
+		                       sizeof(uint16_t) +
+		                       head->sysctls + head->args) {
+			return;
+		}
+		this->head = head;
+		this->it = reinterpret_cast<uint8_t const *>(
+		    args() + head->args);
+		this->eor = this->it;
+	}
+
+	/**
+	 * Check whether the journal is valid.
+	 *
+	 * @return
+	 *	Whether the header could be read
+	 */
+	explicit operator bool() const {
+		return this->head;
+	}
+
+	/**
+	 * Returns the header.
+	 *
+	 * @return
+	 *	A reference to the header of a valid journal
+	 */
+	Header const & header() const {
+		return *this->head;
+	}
+
+	/**
+	 * Returns the core group of every core.
+	 *
+	 * @return
+	 *	An array of ncpu group indices
+	 */
+	uint16_t const * groups() const {
+		return reinterpret_cast<uint16_t const *>(this->head + 1);
+	}
+
+	/**
+	 * Returns the controlling core of every core group.
+	 *
+	 * @return
+	 *	An array of ngroups core indices
+	 */
+	uint16_t const * corei() const {
+		return groups() + this->head->ncpu;
+	}
+
+	/**
+	 * Returns the load recording header text.
+	 *
+	 * @return
+	 *	The text, not terminated
+	 */
+	char const * sysctls() const {
+		return reinterpret_cast<char const *>(
+		    corei() + this->head->ngroups);
+	}
+
+	/**
+	 * Returns the command line text.
+	 *
+	 * @return
+	 *	The text, not terminated
+	 */
+	char const * args() const {
+		return sysctls() + this->head->sysctls;
+	}
+
+	/**
+	 * Advance to the next record.
+	 *
+	 * A truncated record at the end of the file is ignored.
+	 *
+	 * @retval true
+	 *	A record is available
+	 * @retval false
+	 *	The end of the journal was reached
+	 */
+	bool next() {
+		uint64_t len{0};
+		this->it = this->eor;
+		if (!get(this->it, end(), len) ||
+		    len > size_t(end() - this->it)) {
+			this->eor = this->it = end();
+			return false;
+		}
+		this->eor = this->it + len;
+		return true;
+	}
+
+	/**
+	 * Read a value from the current record.
+	 *
+	 * @param value
+	 *	The value to read into
+	 * @return
+	 *	Whether the value was contained in the record
+	 */
+	bool operator ()(uint64_t & value) {
+		return get(this->it, this->eor, value);
+	}
+};
+
+} /* namespace journal */
+
+#endif /* _POWERDXX_JOURNAL_HPP_ */
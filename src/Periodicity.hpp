@@ -0,0 +1,233 @@
+/**
+ * Implements periodicity::Detector, an autocorrelation based
+ * detector for periodic loads.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_PERIODICITY_HPP_
+#define _POWERDXX_PERIODICITY_HPP_
+
+#include "types.hpp"
+
+#include <memory>    /* std::unique_ptr */
+#include <algorithm> /* std::max() */
+#include <cstdint>   /* uint64_t */
+
+/**
+ * Namespace for the detection of periodic loads.
+ */
+namespace periodicity {
+
+using types::mhz_t;
+
+/**
+ * Detects periodic loads, e.g. video playback or frame paced games.
+ *
+ * The detector keeps the autocorrelation of the load over a window
+ * of twice the maximum period for every lag up to the maximum
+ * period. The sums are updated incrementally, so adding a sample
+ * costs O(lags).
+ *
+ * A period is reported once the first local maximum of the
+ * autocorrelation exceeds a correlation coefficient of 0.5 for
+ * the duration of a whole period.
+ */
+class Detector {
+	private:
+	/**
+	 * The maximum period in samples.
+	 */
+	size_t lags{0};
+
+	/**
+	 * The number of samples in the correlation window.
+	 */
+	size_t window{0};
+
+	/**
+	 * The length of the history ring buffer.
+	 *
+	 * The window plus the maximum lag plus the current sample.
+	 */
+	size_t length{0};
+
+	/**
+	 * The ring buffer of load samples.
+	 */
+	std::unique_ptr<mhz_t[]> history;
+
+	/**
+	 * The sums of the products of samples lag apart, indexed by
+	 * lag.
+	 */
+	std::unique_ptr<uint64_t[]> products;
+
+	/**
+	 * The sum of the samples in the window.
+	 */
+	uint64_t sum{0};
+
+	/**
+	 * The sum of the squared samples in the window.
+	 */
+	uint64_t squares{0};
+
+	/**
+	 * The position of the newest sample in the history.
+	 */
+	size_t pos{0};
+
+	/**
+	 * The number of samples taken, saturates at length.
+	 */
+	size_t count{0};
+
+	/**
+	 * The period detected by the last sample.
+	 */
+	size_t candidate{0};
+
+	/**
+	 * The number of consecutive samples detecting the candidate.
+	 */
+	size_t stable{0};
+
+	/**
+	 * Access a sample relative to the newest sample.
+	 *
+	 * @param age
+	 *	The number of samples to go back
+	 * @return
+	 *	The sample
+	 */
+	mhz_t at(size_t const age) const {
+		return this->history[(this->pos + this->length - age) %
+		                     this->length];
+	}
+
+	/**
+	 * Find the period of the current window.
+	 *
+	 * @return
+	 *	The period in samples, 0 if the load is not periodic
+	 */
+	size_t detect() const {
+		double const n = double(this->window);
+		double const mean = this->sum / n;
+		double const var = this->squares / n - mean * mean;
+		/* require some amplitude */
+		if (var <= 0 || var * 64 < mean * mean) {
+			return 0;
+		}
+		double prev = this->products[1] / n - mean * mean;
+		double curr = this->products[2] / n - mean * mean;
+		for (size_t lag = 2; lag <= this->lags; ++lag) {
+			double const next = lag < this->lags
+			                    ? this->products[lag + 1] / n -
+			                      mean * mean
+			                    : curr;
+			if (curr >= prev && curr >= next && curr * 2 >= var) {
+				return lag;
+			}
+			prev = curr;
+			curr = next;
+		}
+		return 0;
+	}
+
+	public:
+	/**
+	 * Construct an inactive detector.
+	 */
+	Detector() = default;
+
+	/**
+	 * Construct a detector.
+	 *
+	 * @param lags
+	 *	The maximum period in samples, at least 2
+	 */
+	explicit Detector(size_t const lags) :
+	    lags{lags}, window{2 * lags}, length{3 * lags + 1},
+	    history{new mhz_t[3 * lags + 1]{}},
+	    products{new uint64_t[lags + 1]{}} {}
+
+	/**
+	 * Check whether the detector is active.
+	 *
+	 * @return
+	 *	Whether samples are processed
+	 */
+	explicit operator bool() const {
+		return this->lags;
+	}
+
+	/**
+	 * Add a load sample.
+	 *
+	 * @param load
+	 *	The load sample
+	 */
+	void operator ()(mhz_t const load) {
+		this->pos = (this->pos + 1) % this->length;
+		this->history[this->pos] = load;
+		this->count += this->count < this->length;
+
+		/* add the new sample, remove the one leaving the window */
+		uint64_t const add = load;
+		uint64_t const sub = at(this->window);
+		this->sum += add;
+		this->sum -= sub;
+		this->squares += add * add;
+		this->squares -= sub * sub;
+		for (size_t lag = 1; lag <= this->lags; ++lag) {
+			this->products[lag] += add * at(lag);
+			this->products[lag] -= sub * at(this->window + lag);
+		}
+
+		/* wait for a full history */
+		if (this->count < this->length) {
+			return;
+		}
+		auto const period = detect();
+		if (period && period + 1 >= this->candidate &&
+		    period <= this->candidate + 1) {
+			++this->stable;
+		} else {
+			this->stable = 0;
+		}
+		this->candidate = period;
+	}
+
+	/**
+	 * Returns the stable period.
+	 *
+	 * @return
+	 *	The period in samples, 0 if no stable period was detected
+	 */
+	size_t period() const {
+		return this->stable >= this->candidate ? this->candidate : 0;
+	}
+
+	/**
+	 * Predict the load of the next sample.
+	 *
+	 * Returns the greatest load of the samples a period ago
+	 * around the phase of the next sample. This raises the clock
+	 * one sample ahead of a predicted peak.
+	 *
+	 * @pre
+	 *	A stable period has been detected
+	 * @return
+	 *	The predicted load
+	 */
+	mhz_t predict() const {
+		auto const period = this->period();
+		return std::max({at(period - 2), at(period - 1), at(period)});
+	}
+};
+
+} /* namespace periodicity */
+
+#endif /* _POWERDXX_PERIODICITY_HPP_ */
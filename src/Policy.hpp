@@ -0,0 +1,328 @@
+/**
+ * Implements policy::Table, a trained clock frequency lookup table.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_POLICY_HPP_
+#define _POWERDXX_POLICY_HPP_
+
+#include "sys/io.hpp"
+
+#include <cstdint>   /* uint32_t, uint16_t, int64_t */
+#include <cstring>   /* memcmp(), memcpy() */
+#include <memory>    /* std::unique_ptr */
+
+/**
+ * Namespace for trained clock frequency policies.
+ *
+ * A policy table maps a set of features, describing the recent
+ * load of a core group and its environment, to a clock frequency.
+ * Tables are produced offline by loadtrain and evaluated by
+ * powerd++ with a single lookup per core group.
+ *
+ * The features are:
+ *
+ * | Feature     | Bins       | Derived from                            |
+ * |-------------|------------|-----------------------------------------|
+ * | load        | load_bins  | Mean load sample / maximum clock        |
+ * | trend       | trend_bins | (Newest - mean load sample) / max clock |
+ * | temperature | temp_bins  | Core temperature vs. high/critical      |
+ * | AC line     | ac_bins    | Battery, online, unknown                |
+ */
+namespace policy {
+
+/**
+ * Identifies a policy table file.
+ */
+char const MAGIC[8]{'p', 'o', 'w', 'e', 'r', 'd', '+', '+'};
+
+/**
+ * The table format version.
+ */
+uint32_t const VERSION{1};
+
+/**
+ * The cell value representing the maximum clock frequency.
+ */
+uint16_t const UNIT{1024};
+
+/**
+ * The cell value deferring the decision to the load feedback loop.
+ */
+uint16_t const UNSET{0xffff};
+
+/**
+ * The default number of load bins.
+ */
+uint16_t const LOAD_BINS{16};
+
+/**
+ * The default number of trend bins.
+ */
+uint16_t const TREND_BINS{5};
+
+/**
+ * The number of temperature bins: cool, hot, critical.
+ */
+uint16_t const TEMP_BINS{3};
+
+/**
+ * The number of AC line state bins: battery, online, unknown.
+ */
+uint16_t const AC_BINS{3};
+
+/**
+ * The policy table file header.
+ *
+ * The header is followed by `ac_bins * temp_bins * trend_bins *
+ * load_bins` cells of type `uint16_t`. The cells are laid out
+ * like a C array `cells[ac][temp][trend][load]`.
+ *
+ * A cell contains the clock frequency as a fraction of UNIT of the
+ * maximum clock frequency of the core group, or UNSET.
+ *
+ * All values are in host byte order.
+ */
+struct Header {
+	/**
+	 * Must be MAGIC.
+	 */
+	char magic[8];
+
+	/**
+	 * Must be VERSION.
+	 */
+	uint32_t version;
+
+	/**
+	 * The number of load samples the table was trained with.
+	 */
+	uint32_t samples;
+
+	/**
+	 * The number of load bins.
+	 */
+	uint16_t load_bins;
+
+	/**
+	 * The number of trend bins.
+	 */
+	uint16_t trend_bins;
+
+	/**
+	 * The number of temperature bins.
+	 */
+	uint16_t temp_bins;
+
+	/**
+	 * The number of AC line state bins, must be AC_BINS.
+	 */
+	uint16_t ac_bins;
+};
+
+static_assert(sizeof(Header) == 24,
+              "the header must keep the cells 16 bit aligned");
+
+/**
+ * Returns the number of cells in a table.
+ *
+ * @param head
+ *	The table header
+ * @return
+ *	The number of cells following the header
+ */
+inline size_t cells(Header const & head) {
+	return size_t{head.ac_bins} * head.temp_bins *
+	       head.trend_bins * head.load_bins;
+}
+
+/**
+ * Returns the cell index for a set of feature bins.
+ *
+ * @param head
+ *	The table header
+ * @param ac,temp,trend,load
+ *	The feature bins
+ * @return
+ *	The cell index
+ */
+inline size_t index(Header const & head, unsigned const ac,
+                    unsigned const temp, unsigned const trend,
+                    unsigned const load) {
+	return ((size_t{ac} * head.temp_bins + temp) *
+	        head.trend_bins + trend) * head.load_bins + load;
+}
+
+/**
+ * Clamp a bin to the valid range.
+ *
+ * @param bin
+ *	The bin to clamp
+ * @param bins
+ *	The number of bins
+ * @return
+ *	The bin in the range [0, bins - 1]
+ */
+inline unsigned clamp(int64_t const bin, unsigned const bins) {
+	return bin < 0 ? 0 : bin >= bins ? bins - 1 : unsigned(bin);
+}
+
+/**
+ * Returns the load bin.
+ *
+ * @param bins
+ *	The number of load bins
+ * @param mean
+ *	The mean load of the sample window in MHz
+ * @param ref
+ *	The maximum clock frequency in MHz
+ * @return
+ *	The load bin
+ */
+inline unsigned load_bin(unsigned const bins, int64_t const mean,
+                         int64_t const ref) {
+	return clamp(mean * bins / ref, bins);
+}
+
+/**
+ * Returns the trend bin.
+ *
+ * The bins divide the range [-ref/4, +ref/4] evenly, so the middle
+ * bin of an odd number of bins represents a steady load. Greater
+ * changes fall into the outermost bins.
+ *
+ * @param bins
+ *	The number of trend bins
+ * @param newest
+ *	The newest load sample in MHz
+ * @param mean
+ *	The mean load of the sample window in MHz
+ * @param ref
+ *	The maximum clock frequency in MHz
+ * @return
+ *	The trend bin
+ */
+inline unsigned trend_bin(unsigned const bins, int64_t const newest,
+                          int64_t const mean, int64_t const ref) {
+	return clamp((4 * (newest - mean) + ref) * bins / (2 * ref), bins);
+}
+
+/**
+ * Returns the temperature bin.
+ *
+ * The last bin is reserved for critical temperatures, the
+ * remaining bins divide the range [high - (crit - high), crit)
+ * evenly. With TEMP_BINS this results in the bins below high,
+ * the throttling range and critical.
+ *
+ * @param bins
+ *	The number of temperature bins
+ * @param temp,high,crit
+ *	The current, high and critical temperature
+ * @return
+ *	The temperature bin
+ */
+inline unsigned temp_bin(unsigned const bins, int64_t const temp,
+                         int64_t const high, int64_t const crit) {
+	if (temp >= crit) {
+		return bins - 1;
+	}
+	auto const range = crit - high;
+	if (bins < 2 || range <= 0) {
+		return 0;
+	}
+	return clamp((temp - high + range) * (bins - 1) / (2 * range),
+	             bins - 1);
+}
+
+/**
+ * A read-only policy table.
+ *
+ * The table is copied out of the mapped table file, so replacing or
+ * truncating the file while it is in use has no effect.
+ */
+class Table {
+	private:
+	/**
+	 * The table header.
+	 */
+	Header head{};
+
+	/**
+	 * The table cells, nullptr for an invalid table.
+	 */
+	std::unique_ptr<uint16_t[]> data;
+
+	public:
+	/**
+	 * Construct an invalid table.
+	 */
+	Table() = default;
+
+	/**
+	 * Copy a table from a mapped table file.
+	 *
+	 * The table is invalid if the header does not match this
+	 * implementation or the file size does not match the header.
+	 *
+	 * @param map
+	 *	The mapped table file
+	 */
+	explicit Table(sys::io::mapping const & map) {
+		if (!map || map.size() < sizeof(Header)) {
+			return;
+		}
+		std::memcpy(&this->head, map.begin(), sizeof(Header));
+		auto const & head = this->head;
+		if (0 != std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) ||
+		    head.version != VERSION || head.ac_bins != AC_BINS ||
+		    !head.load_bins || !head.trend_bins || !head.temp_bins ||
+		    map.size() != sizeof(Header) +
+		                  cells(head) * sizeof(uint16_t)) {
+			return;
+		}
+		this->data = std::unique_ptr<uint16_t[]>{
+		    new uint16_t[cells(head)]};
+		std::memcpy(this->data.get(), map.begin() + sizeof(Header),
+		            cells(head) * sizeof(uint16_t));
+	}
+
+	/**
+	 * Check whether the table is valid.
+	 *
+	 * @return
+	 *	Whether lookups can be performed
+	 */
+	explicit operator bool() const {
+		return this->data != nullptr;
+	}
+
+	/**
+	 * Returns the table header.
+	 *
+	 * @return
+	 *	A reference to the header of a valid table
+	 */
+	Header const & header() const {
+		return this->head;
+	}
+
+	/**
+	 * Look up the cell for a set of feature bins.
+	 *
+	 * @param ac,temp,trend,load
+	 *	The feature bins
+	 * @return
+	 *	The clock frequency as a fraction of UNIT or UNSET
+	 */
+	uint16_t operator ()(unsigned const ac, unsigned const temp,
+	                     unsigned const trend,
+	                     unsigned const load) const {
+		return this->data[index(this->head, ac, temp, trend, load)];
+	}
+};
+
+} /* namespace policy */
+
+#endif /* _POWERDXX_POLICY_HPP_ */
@@ -0,0 +1,446 @@
+/**
+ * Implements topology::Topology, a parser for the scheduler topology.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_TOPOLOGY_HPP_
+#define _POWERDXX_TOPOLOGY_HPP_
+
+#include "types.hpp"
+
+#include <vector>   /* std::vector */
+#include <utility>  /* std::pair */
+#include <cstring>  /* strncmp(), strlen() */
+#include <cstdlib>  /* strtoul() */
+
+/**
+ * Namespace for CPU topology related functionality.
+ */
+namespace topology {
+
+using types::coreid_t;
+
+/**
+ * Group flags, the values match the kernel CG_FLAG_* constants.
+ */
+enum flag : unsigned {
+	HTT     = 0x01, /**< Hyper threading siblings */
+	SMT     = 0x02, /**< Simultaneous multi threading siblings */
+	THREAD  = 0x03, /**< Any kind of thread siblings */
+	NOSHARE = 0x04, /**< The group does not share a cache */
+	NODE    = 0x08, /**< A NUMA node */
+};
+
+/**
+ * A node of the CPU topology tree.
+ */
+struct Group {
+	/**
+	 * The depth of the group, the root is level 1.
+	 */
+	unsigned level{0};
+
+	/**
+	 * The cache level shared by all CPUs of the group, 0 for none.
+	 */
+	unsigned cache_level{0};
+
+	/**
+	 * A combination of group flags.
+	 */
+	unsigned flags{0};
+
+	/**
+	 * The CPUs in the group.
+	 */
+	std::vector<coreid_t> cpus;
+
+	/**
+	 * The sub groups.
+	 */
+	std::vector<Group> children;
+
+	/**
+	 * Check whether a CPU is a member of the group.
+	 *
+	 * @param cpu
+	 *	The CPU to look for
+	 * @return
+	 *	Whether the CPU is a member
+	 */
+	bool contains(coreid_t const cpu) const {
+		for (auto const member : this->cpus) {
+			if (member == cpu) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * Parses the kern.sched.topology_spec XML into a tree of CPU groups.
+ *
+ * The format is produced by the FreeBSD scheduler:
+ *
+ * ~~~ xml
+ * <groups>
+ *  <group level="1" cache-level="3">
+ *   <cpu count="4" mask="f,0,0,0">0, 1, 2, 3</cpu>
+ *   <children>
+ *    <group level="2" cache-level="2">
+ *     <cpu count="2" mask="3,0,0,0">0, 1</cpu>
+ *     <flags><flag name="THREAD">THREAD group</flag></flags>
+ *    </group>
+ *    …
+ *   </children>
+ *  </group>
+ * </groups>
+ * ~~~
+ *
+ * Only the subset of XML used by the kernel is understood, unknown
+ * elements cause the whole specification to be rejected, resulting
+ * in an empty topology.
+ */
+class Topology {
+	private:
+	/**
+	 * The root group, has no CPUs if no topology is available.
+	 */
+	Group root;
+
+	/**
+	 * The parser state, the next character to consume.
+	 */
+	char const * pos{nullptr};
+
+	/**
+	 * Skip white space.
+	 */
+	void skip() {
+		while (*this->pos == ' ' || *this->pos == '\t' ||
+		       *this->pos == '\n' || *this->pos == '\r') {
+			++this->pos;
+		}
+	}
+
+	/**
+	 * Consume the given string if it is next.
+	 *
+	 * @param str
+	 *	The string to consume
+	 * @return
+	 *	Whether the string was consumed
+	 */
+	bool accept(char const * const str) {
+		auto const len = std::strlen(str);
+		if (0 != std::strncmp(this->pos, str, len)) {
+			return false;
+		}
+		this->pos += len;
+		return true;
+	}
+
+	/**
+	 * Consume an opening tag.
+	 *
+	 * The attributes of the tag are passed to a callback.
+	 *
+	 * @tparam AttrFunc
+	 *	The callback type
+	 * @param name
+	 *	The tag name
+	 * @param attr
+	 *	A callback taking the attribute name and value as
+	 *	`char const *` pointers and the name and value lengths
+	 * @return
+	 *	Whether the tag was consumed
+	 */
+	template <class AttrFunc>
+	bool open(char const * const name, AttrFunc && attr) {
+		skip();
+		auto const start = this->pos;
+		if (!accept("<") || !accept(name) ||
+		    (*this->pos != ' ' && *this->pos != '>')) {
+			this->pos = start;
+			return false;
+		}
+		for (skip(); *this->pos && *this->pos != '>'; skip()) {
+			auto const key = this->pos;
+			while (*this->pos && *this->pos != '=') { ++this->pos; }
+			auto const keylen = size_t(this->pos - key);
+			if (!accept("=\"")) { return false; }
+			auto const value = this->pos;
+			while (*this->pos && *this->pos != '"') { ++this->pos; }
+			auto const valuelen = size_t(this->pos - value);
+			if (!accept("\"")) { return false; }
+			attr(key, keylen, value, valuelen);
+		}
+		return accept(">");
+	}
+
+	/**
+	 * Consume an opening tag, ignore its attributes.
+	 *
+	 * @param name
+	 *	The tag name
+	 * @return
+	 *	Whether the tag was consumed
+	 */
+	bool open(char const * const name) {
+		return open(name, [](auto...) {});
+	}
+
+	/**
+	 * Consume a closing tag.
+	 *
+	 * @param name
+	 *	The tag name
+	 * @return
+	 *	Whether the tag was consumed
+	 */
+	bool close(char const * const name) {
+		skip();
+		auto const start = this->pos;
+		if (accept("</") && accept(name) && accept(">")) {
+			return true;
+		}
+		this->pos = start;
+		return false;
+	}
+
+	/**
+	 * Consume text up to the next tag.
+	 *
+	 * @return
+	 *	A pointer to the beginning of the text
+	 */
+	char const * text() {
+		auto const start = this->pos;
+		while (*this->pos && *this->pos != '<') { ++this->pos; }
+		return start;
+	}
+
+	/**
+	 * Parse a group and its children.
+	 *
+	 * @param group
+	 *	The group to populate
+	 * @return
+	 *	Whether the group was parsed successfully
+	 */
+	bool parse(Group & group) {
+		auto const attr = [&group](char const * key, size_t keylen,
+		                           char const * value, size_t) {
+			if (keylen == 5 && 0 == std::strncmp(key, "level", 5)) {
+				group.level = std::strtoul(value, nullptr, 10);
+			} else if (keylen == 11 &&
+			           0 == std::strncmp(key, "cache-level", 11)) {
+				group.cache_level = std::strtoul(value, nullptr, 10);
+			}
+		};
+		if (!open("group", attr)) {
+			return false;
+		}
+		while (!close("group")) {
+			if (open("cpu")) {
+				char * end{nullptr};
+				for (auto cpu = text(); cpu < this->pos; cpu = end) {
+					auto const id = std::strtoul(cpu, &end, 10);
+					if (end == cpu) { break; }
+					group.cpus.push_back(coreid_t(id));
+					while (end < this->pos &&
+					       (*end == ',' || *end == ' ')) {
+						++end;
+					}
+				}
+				if (!close("cpu")) { return false; }
+			} else if (open("children")) {
+				while (!close("children")) {
+					group.children.emplace_back();
+					if (!parse(group.children.back())) {
+						return false;
+					}
+				}
+			} else if (open("flags")) {
+				while (!close("flags")) {
+					unsigned flags{0};
+					auto const attr = [&flags](char const *, size_t,
+					                           char const * value,
+					                           size_t len) {
+						for (auto const & [name, bits] : {
+						    std::pair{"HTT", HTT},
+						    std::pair{"SMT", SMT},
+						    std::pair{"THREAD", THREAD},
+						    std::pair{"NOSHARE", NOSHARE},
+						    std::pair{"NODE", NODE}}) {
+							if (len == std::strlen(name) &&
+							    0 == std::strncmp(value, name, len)) {
+								flags |= bits;
+							}
+						}
+					};
+					if (!open("flag", attr)) { return false; }
+					text();
+					if (!close("flag")) { return false; }
+					group.flags |= flags;
+				}
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Append the CPUs of a group in depth first order.
+	 *
+	 * @param group
+	 *	The group to traverse
+	 * @param order
+	 *	The list to append to
+	 */
+	static void order(Group const & group, std::vector<coreid_t> & order) {
+		if (group.children.empty()) {
+			order.insert(order.end(), group.cpus.begin(),
+			             group.cpus.end());
+			return;
+		}
+		for (auto const & child : group.children) {
+			Topology::order(child, order);
+		}
+		/* CPUs not covered by any child */
+		for (auto const cpu : group.cpus) {
+			bool covered{false};
+			for (auto const & child : group.children) {
+				covered = covered || child.contains(cpu);
+			}
+			if (!covered) {
+				order.push_back(cpu);
+			}
+		}
+	}
+
+	/**
+	 * Collect the package groups below a group.
+	 *
+	 * @param group
+	 *	The group to traverse
+	 * @param packages
+	 *	The list to append to
+	 */
+	static void packages(Group const & group,
+	                     std::vector<Group const *> & packages) {
+		if (group.cache_level || (group.flags & NODE) ||
+		    (group.flags & THREAD) || group.children.empty()) {
+			packages.push_back(&group);
+			return;
+		}
+		for (auto const & child : group.children) {
+			Topology::packages(child, packages);
+		}
+	}
+
+	public:
+	/**
+	 * Construct an empty topology.
+	 */
+	Topology() = default;
+
+	/**
+	 * Parse a topology specification.
+	 *
+	 * If the specification cannot be parsed the topology is empty.
+	 *
+	 * @param spec
+	 *	The kern.sched.topology_spec string
+	 */
+	explicit Topology(char const * const spec) : pos{spec} {
+		if (!open("groups") || !parse(this->root) || !close("groups")) {
+			this->root = Group{};
+		}
+		this->pos = nullptr;
+	}
+
+	/**
+	 * Check whether a topology is available.
+	 *
+	 * @return
+	 *	Whether the topology contains any CPUs
+	 */
+	explicit operator bool() const {
+		return !this->root.cpus.empty();
+	}
+
+	/**
+	 * Returns the root group.
+	 *
+	 * @return
+	 *	A reference to the root group
+	 */
+	Group const & top() const {
+		return this->root;
+	}
+
+	/**
+	 * Returns the groups a CPU is a member of.
+	 *
+	 * @param cpu
+	 *	The CPU to look for
+	 * @return
+	 *	The groups from the root to the smallest group containing
+	 *	the CPU, empty if the CPU is unknown
+	 */
+	std::vector<Group const *> path(coreid_t const cpu) const {
+		std::vector<Group const *> path;
+		for (auto group = &this->root; group && group->contains(cpu);) {
+			path.push_back(group);
+			auto const parent = group;
+			group = nullptr;
+			for (auto const & child : parent->children) {
+				if (child.contains(cpu)) {
+					group = &child;
+					break;
+				}
+			}
+		}
+		return path;
+	}
+
+	/**
+	 * Returns all CPUs in depth first order.
+	 *
+	 * CPUs sharing a cache are adjacent in this order.
+	 *
+	 * @return
+	 *	The list of CPUs
+	 */
+	std::vector<coreid_t> order() const {
+		std::vector<coreid_t> result;
+		Topology::order(this->root, result);
+		return result;
+	}
+
+	/**
+	 * Returns the package groups.
+	 *
+	 * A package is the outermost group that shares a cache or
+	 * is a NUMA node. This corresponds to a physical package or
+	 * die on most systems.
+	 *
+	 * @return
+	 *	The list of package groups, empty for an empty topology
+	 */
+	std::vector<Group const *> packages() const {
+		std::vector<Group const *> result;
+		if (*this) {
+			Topology::packages(this->root, result);
+		}
+		return result;
+	}
+};
+
+} /* namespace topology */
+
+#endif /* _POWERDXX_TOPOLOGY_HPP_ */
@@ -259,6 +259,29 @@ size_t clas::samples(char const * const str) {
 	return value;
 }
 
+size_t clas::count(char const * const str, size_t const max) {
+	using namespace utility::literals;
+
+	if (!str || !*str) {
+		errors::fail(errors::Exit::ECOUNT, 0, "count value missing");
+	}
+
+	auto value = Value{str};
+	if (value != Unit::SCALAR) {
+		errors::fail(errors::Exit::ECOUNT, 0,
+		             "count must be a scalar integer");
+	}
+	if (value != static_cast<size_t>(value)) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "count must be an integer");
+	}
+	if (value < 1 || value > max) {
+		errors::fail(errors::Exit::EOUTOFRANGE, 0,
+		             "count must be in the range [1, %zu]"_fmt(max));
+	}
+	return value;
+}
+
 types::decikelvin_t clas::temperature(char const * const str) {
 	if (!str || !*str) {
 		errors::fail(errors::Exit::ETEMPERATURE, 0,
@@ -92,6 +92,21 @@ types::ms ival(char const * const str);
  */
 size_t samples(char const * const str);
 
+/**
+ * A string encoded count.
+ *
+ * The string is expected to contain a scalar integer in the
+ * range [1, max].
+ *
+ * @param str
+ *	The string containing the count
+ * @param max
+ *	The maximum count
+ * @return
+ *	The count
+ */
+size_t count(char const * const str, size_t const max);
+
 /**
  * Convert string to temperature in dK.
  *
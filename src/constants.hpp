@@ -63,6 +63,17 @@ char const * const FREQ_DRIVER_BLACKLIST[]{
 	"hwpstate_"
 };
 
+/**
+ * The MIB name for the energy/performance preference of hardware
+ * P-states.
+ */
+char const * const EPP = "dev.hwpstate_intel.%d.epp";
+
+/**
+ * The MIB name for the scheduler CPU topology.
+ */
+char const * const TOPOLOGY = "kern.sched.topology_spec";
+
 /*
  * Default values.
  */
@@ -87,6 +98,47 @@ types::mhz_t const FREQ_UNSET{1000001};
  */
 char const * const POWERD_PIDFILE = "/var/run/powerd.pid";
 
+/**
+ * The default boost hint socket.
+ */
+char const * const HINT_SOCKET = "/var/run/powerd++.sock";
+
+/**
+ * The default number of boost hints accepted per second.
+ */
+unsigned int const HINT_RATE{10};
+
+/**
+ * The maximum number of boost hints accepted per second.
+ */
+size_t const HINT_RATE_MAX{1000};
+
+/**
+ * The maximum duration of a boost hint.
+ */
+types::ms const HINT_DURATION_MAX{10000};
+
+/**
+ * The default journal size limit in MiB.
+ */
+size_t const JOURNAL_SIZE{16};
+
+/**
+ * The maximum journal size limit in MiB.
+ */
+size_t const JOURNAL_SIZE_MAX{4096};
+
+/**
+ * The maximum number of cycles between clock frequency reads.
+ */
+size_t const VERIFY_MAX{1000};
+
+/**
+ * The maximum number of frames between temperature or AC line
+ * state samples in load recordings.
+ */
+size_t const SUBSAMPLE_MAX{1000};
+
 /**
  * The load target for adaptive mode, equals 50% load.
  */
@@ -102,6 +154,12 @@ types::cptime_t const HADP{384};
  */
 types::decikelvin_t const HITEMP_OFFSET{100};
 
+/**
+ * The minimum change of the energy/performance preference, smaller
+ * changes are not applied.
+ */
+int const EPP_HYSTERESIS{5};
+
 } /* namespace constants */
 
 #endif /* _POWERDXX_CONSTANTS_HPP_ */
@@ -44,6 +44,10 @@ enum class Exit : int {
 	EDRIVER,      /**< Frequency driver does not allow manual control */
 	ESYSCTLNAME,  /**< User provided sysctl contains invalid characters */
 	EFORMATFIELD, /**< Formatting string contains unexpected field */
+	EEVENT,       /**< Failed to set up the event reactor */
+	ESOCKET,      /**< Failed to set up or use the boost hint socket */
+	EPOLICY,      /**< The policy table cannot be used */
+	ECOUNT,       /**< The provided value is not a valid count */
 	LENGTH        /**< Enum length */
 };
 
@@ -54,7 +58,8 @@ const char * const ExitStr[]{
 	"OK", "ECLARG", "EOUTOFRANGE", "ELOAD", "EFREQ", "EMODE", "EIVAL",
 	"ESAMPLES", "ESYSCTL", "ENOFREQ", "ECONFLICT", "EPID", "EFORBIDDEN",
 	"EDAEMON", "EWOPEN", "ESIGNAL", "ERANGEFMT", "ETEMPERATURE",
-	"EEXCEPT", "EFILE", "EEXEC", "EDRIVER", "ESYSCTLNAME", "EFORMATFIELD"
+	"EEXCEPT", "EFILE", "EEXEC", "EDRIVER", "ESYSCTLNAME", "EFORMATFIELD",
+	"EEVENT", "ESOCKET", "EPOLICY", "ECOUNT"
 };
 
 static_assert(size_t{utility::to_value(Exit::LENGTH)} == utility::countof(ExitStr),
@@ -0,0 +1,315 @@
+/**
+ * Implements the boost hint protocol between clients and powerd++.
+ *
+ * Clients send fixed size datagrams over a local socket, each
+ * requesting a minimum clock frequency for a limited time.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_HINT_HPP_
+#define _POWERDXX_HINT_HPP_
+
+#include "sys/error.hpp"  /* sys::sc_error */
+
+#include <cstdint>        /* uint32_t, int32_t, uint16_t, uint8_t */
+#include <cstring>        /* strlen(), memcpy() */
+#include <cerrno>         /* errno, EINTR, EEXIST, ENAMETOOLONG */
+
+#include <sys/types.h>    /* mode_t */
+#include <sys/socket.h>   /* socket(), bind(), sendto(), recv() */
+#include <sys/stat.h>     /* lstat(), chmod() */
+#include <sys/un.h>       /* struct sockaddr_un */
+#include <unistd.h>       /* close(), unlink() */
+
+/**
+ * Namespace for the boost hint protocol.
+ */
+namespace hint {
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * Identifies a boost request datagram.
+ */
+uint32_t const MAGIC{0x50445842};
+
+/**
+ * The protocol version.
+ */
+uint16_t const VERSION{1};
+
+/**
+ * The core number addressing all cores.
+ */
+int32_t const ALL{-1};
+
+/**
+ * A boost request.
+ *
+ * Requests that the clock frequency of the core group containing
+ * the given core is at least freq for duration milliseconds.
+ *
+ * The layout is the datagram format, all values are in host byte
+ * order.
+ */
+struct Request {
+	/**
+	 * Must be MAGIC.
+	 */
+	uint32_t magic{MAGIC};
+
+	/**
+	 * Must be VERSION.
+	 */
+	uint16_t version{VERSION};
+
+	/**
+	 * The request priority.
+	 *
+	 * An active boost can only be replaced by a request of the
+	 * same or a higher priority.
+	 */
+	uint8_t priority{0};
+
+	/**
+	 * Reserved, must be 0.
+	 */
+	uint8_t reserved{0};
+
+	/**
+	 * The core to boost, ALL for all cores.
+	 */
+	int32_t core{ALL};
+
+	/**
+	 * The minimum clock frequency in MHz.
+	 */
+	uint32_t freq{0};
+
+	/**
+	 * The duration of the boost in ms.
+	 */
+	uint32_t duration{0};
+};
+
+static_assert(sizeof(Request) == 20, "the datagram format must be packed");
+
+/**
+ * Fill a local socket address.
+ *
+ * @param addr
+ *	The address to fill
+ * @param path
+ *	The socket path
+ * @throws sys::sc_error<error>
+ *	ENAMETOOLONG if the path does not fit the address
+ */
+inline void address(sockaddr_un & addr, char const * const path) {
+	auto const len = std::strlen(path);
+	if (len >= sizeof(addr.sun_path)) {
+		throw sys::sc_error<error>{ENAMETOOLONG};
+	}
+	addr = sockaddr_un{};
+	addr.sun_family = AF_UNIX;
+	std::memcpy(addr.sun_path, path, len + 1);
+}
+
+/**
+ * Sends boost requests to a powerd++ instance.
+ */
+class Client {
+	private:
+	/**
+	 * The socket file descriptor.
+	 */
+	int fd{-1};
+
+	/**
+	 * The address of the daemon socket.
+	 */
+	sockaddr_un addr;
+
+	public:
+	/**
+	 * Create a socket for sending requests.
+	 *
+	 * @param path
+	 *	The daemon socket path
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of socket()
+	 */
+	explicit Client(char const * const path) {
+		address(this->addr, path);
+		if (-1 == (this->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC,
+		                             0))) {
+			throw sys::sc_error<error>{errno};
+		}
+	}
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 */
+	Client(Client const &) = delete;
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 *
+	 * @return
+	 *	A self reference
+	 */
+	Client & operator =(Client const &) = delete;
+
+	/**
+	 * Close the socket.
+	 */
+	~Client() {
+		close(this->fd);
+	}
+
+	/**
+	 * Send a request.
+	 *
+	 * @param req
+	 *	The request to send
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of sendto(), e.g. ENOENT or
+	 *	ECONNREFUSED if the daemon is not listening
+	 */
+	void operator ()(Request const & req) const {
+		if (-1 == sendto(this->fd, &req, sizeof(req), 0,
+		                 reinterpret_cast<sockaddr const *>(&this->addr),
+		                 sizeof(this->addr))) {
+			throw sys::sc_error<error>{errno};
+		}
+	}
+};
+
+/**
+ * Receives boost requests.
+ *
+ * The socket is non-blocking, so it can be watched by an event
+ * reactor and drained when readable.
+ */
+class Listener {
+	private:
+	/**
+	 * The socket file descriptor.
+	 */
+	int fd{-1};
+
+	/**
+	 * The socket path.
+	 */
+	char const * const path;
+
+	public:
+	/**
+	 * Create the socket.
+	 *
+	 * A stale socket at the given path is replaced, any other
+	 * kind of file is not.
+	 *
+	 * @param path
+	 *	The socket path
+	 * @param mode
+	 *	The access mode of the socket, only clients with write
+	 *	permission can send requests
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of the failing call, EEXIST if
+	 *	the path exists and is not a socket
+	 */
+	Listener(char const * const path, mode_t const mode) : path{path} {
+		sockaddr_un addr;
+		address(addr, path);
+		struct stat st;
+		if (0 == lstat(path, &st)) {
+			if (!S_ISSOCK(st.st_mode)) {
+				throw sys::sc_error<error>{EEXIST};
+			}
+			unlink(path);
+		}
+		if (-1 == (this->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC |
+		                                      SOCK_NONBLOCK, 0))) {
+			throw sys::sc_error<error>{errno};
+		}
+		if (-1 == bind(this->fd, reinterpret_cast<sockaddr const *>(&addr),
+		               sizeof(addr))) {
+			auto const err = errno;
+			close(this->fd);
+			throw sys::sc_error<error>{err};
+		}
+		if (-1 == chmod(path, mode)) {
+			auto const err = errno;
+			close(this->fd);
+			unlink(path);
+			throw sys::sc_error<error>{err};
+		}
+	}
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 */
+	Listener(Listener const &) = delete;
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 *
+	 * @return
+	 *	A self reference
+	 */
+	Listener & operator =(Listener const &) = delete;
+
+	/**
+	 * Close and remove the socket.
+	 */
+	~Listener() {
+		close(this->fd);
+		unlink(this->path);
+	}
+
+	/**
+	 * Returns the socket file descriptor.
+	 *
+	 * @return
+	 *	The file descriptor
+	 */
+	int fileno() const {
+		return this->fd;
+	}
+
+	/**
+	 * Receive the next valid request.
+	 *
+	 * Datagrams that do not match the format are discarded.
+	 *
+	 * @param req
+	 *	The request to fill
+	 * @retval true
+	 *	A request was received
+	 * @retval false
+	 *	No more requests are pending
+	 */
+	bool operator ()(Request & req) const {
+		while (true) {
+			auto const len = recv(this->fd, &req, sizeof(req), 0);
+			if (len == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			if (size_t(len) == sizeof(req) && req.magic == MAGIC &&
+			    req.version == VERSION && req.reserved == 0) {
+				return true;
+			}
+		}
+	}
+};
+
+} /* namespace hint */
+
+#endif /* _POWERDXX_HINT_HPP_ */
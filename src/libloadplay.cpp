@@ -7,10 +7,15 @@
  *
  * The following environment variables affect the operation of loadplay:
  *
- * | Variable     | Description             |
- * |--------------|-------------------------|
- * | LOADPLAY_IN  | Alternative input file  |
- * | LOADPLAY_OUT | Alternative output file |
+ * | Variable      | Description                         |
+ * |---------------|-------------------------------------|
+ * | LOADPLAY_IN   | Alternative input file              |
+ * | LOADPLAY_OUT  | Alternative output file             |
+ * | LOADPLAY_LIVE | Live input, number of frames buffer |
+ * | LOADPLAY_START| Replay window start in ms           |
+ * | LOADPLAY_END  | Replay window end in ms             |
+ * | LOADPLAY_INDEX| Frame index file for seeking        |
+ * | LOADPLAY_VFS  | Virtual procfs/sysfs path prefixes  |
  *
  * @file
  */
@@ -24,17 +29,28 @@
 #include <unordered_map>
 #include <map>
 #include <string>
-#include <regex>
 #include <memory>    /* std::unique_ptr */
 #include <thread>
 #include <exception>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <chrono>    /* std::chrono::steady_clock::now() */
 #include <vector>
-#include <algorithm> /* std::min() */
-
-#include <cstring>   /* strncmp() */
+#include <algorithm> /* std::min(), std::copy() */
+#include <limits>    /* std::numeric_limits */
+#include <functional> /* std::function */
+#include <utility>   /* std::pair */
+#include <atomic>    /* std::atomic */
+
+#include <cmath>     /* std::ceil() */
+#include <cstring>   /* strncmp(), memchr(), memcpy() */
+#include <cstdio>    /* sscanf() */
+#include <cstdarg>   /* va_list */
+#include <cstdlib>   /* free() */
+#include <cctype>    /* std::isdigit(), std::isspace() */
 #include <cassert>   /* assert() */
+#include <cerrno>    /* errno */
 #include <csignal>   /* raise() */
 
 #include <sys/types.h>
@@ -43,7 +59,9 @@
 #include <libutil.h>       /* struct pidfh */
 
 #include <dlfcn.h>         /* dlfung() */
-#include <unistd.h>        /* getpid() */
+#include <unistd.h>        /* getpid(), read(), write() etc. */
+#include <fcntl.h>         /* open(), openat() */
+#include <poll.h>          /* poll() */
 
 /**
  * File local scope.
@@ -57,6 +75,9 @@ using constants::FREQ_LEVELS;
 using constants::FREQ_DRIVER;
 using constants::TEMPERATURE;
 using constants::TJMAX_SOURCES;
+using constants::TOPOLOGY;
+using constants::EPP;
+using constants::FREQ_DEFAULT_MIN;
 
 using utility::sprintf_safe;
 using namespace utility::literals;
@@ -64,9 +85,11 @@ using utility::Sum;
 using utility::FromChars;
 
 using types::ms;
+using us = std::chrono::microseconds;  /**< Microseconds type. */
 using types::cptime_t;
 using types::mhz_t;
 using types::coreid_t;
+using types::decikelvin_t;
 using cycles_t = uint64_t;  /**< Clock cycle counting type. */
 
 using version::LOADREC_FEATURES;
@@ -97,9 +120,32 @@ template <auto Ownership> using ifile = io::file<Ownership, io::read>;
  * This value is used to ensure correct input data interpretation.
  */
 constexpr flag_t const FEATURES{
-	1_FREQ_TRACKING
+	1_FREQ_TRACKING |
+	1_DURATION_US |
+	1_TEMP_TRACKING |
+	1_ACLINE_TRACKING
 };
 
+/**
+ * The load record header entry containing the turbo table.
+ *
+ * The table lists the maximum clock frequency for a number of active
+ * cores in the format `cores/MHz cores/MHz ...`, similar to
+ * `dev.cpu.%d.freq_levels`.
+ */
+char const * const TURBO_TABLE = "usr.app.powerdxx.loadplay.turbo";
+
+/**
+ * The buffer size for input and output files.
+ */
+constexpr size_t const BUFFER_SIZE{65536};
+
+/**
+ * The time in [ms] the live input reader waits for input before
+ * checking whether it should terminate.
+ */
+constexpr int const LIVE_POLL_TIMEOUT{100};
+
 /**
  * Safe wrapper around strncmp, which automatically determines the
  * buffer size of s2.
@@ -119,15 +165,26 @@ inline int strcmp(char const * const s1, char const (&s2)[Size]) {
 }
 
 /**
- * User defined literal for regular expressions.
+ * Locate the numerical component of a MIB name.
+ *
+ * E.g. the numerical component of "dev.cpu.0.freq" is "0".
  *
- * @param str,len
- *	The literal string and its length
+ * @param name
+ *	The MIB name
  * @return
- *	A regular expression
+ *	The offset and the length of the numerical component, the
+ *	length is 0 if the name does not have a numerical component
  */
-inline std::regex operator "" _r(char const * const str, size_t const len) {
-	return {str, len, std::regex::ECMAScript};
+std::pair<size_t, size_t> mib_index(std::string const & name) {
+	for (auto pos = name.find('.'); pos != std::string::npos;
+	     pos = name.find('.', pos + 1)) {
+		auto last = pos + 1;
+		for (; last < name.size() && std::isdigit(name[last]); ++last);
+		if (last > pos + 1 && last < name.size() && name[last] == '.') {
+			return {pos + 1, last - pos - 1};
+		}
+	}
+	return {name.size(), 0};
 }
 
 /**
@@ -483,11 +540,8 @@ class SysctlValue {
 	template <typename T>
 	int get(T * dst, size_t & size) const {
 		std::scoped_lock const lock{this->mtx};
-		size /= sizeof(T);
-		size_t i = 0;
 		auto fetch = FromChars{this->value};
-		for (; i < size && fetch(dst[i]); ++i);
-		size = i * sizeof(T);
+		size = fetch(dst, size / sizeof(T)) * sizeof(T);
 		return errno = fetch * ENOMEM, -fetch;
 	}
 
@@ -776,7 +830,10 @@ class Sysctls {
 		{LOADREC_FEATURES, {1004}},
 		{FREQ_DRIVER,      {1005, -1}},
 		{TEMPERATURE,      {1006, -1}},
-		{TJMAX_SOURCES[0], {1007, -1}}
+		{TJMAX_SOURCES[0], {1007, -1}},
+		{TOPOLOGY,         {1008}},
+		{EPP,              {1009, -1}},
+		{TURBO_TABLE,      {1010}}
 	};
 
 	/**
@@ -794,6 +851,9 @@ class Sysctls {
 		{{1005, -1},           {CTLTYPE_STRING, ""}},
 		{{1006, -1},           {CTLTYPE_INT,    "-1"}},
 		{{1007, -1},           {CTLTYPE_INT,    "-1"}},
+		{{1008},               {CTLTYPE_STRING, ""}},
+		{{1009, -1},           {CTLTYPE_INT,    "-1"}},
+		{{1010},               {CTLTYPE_STRING, ""}},
 	};
 
 	public:
@@ -832,10 +892,8 @@ class Sysctls {
 				return;
 			}
 			/* get mib numbers */
-			std::smatch match;
-			auto const expr = "\\.([0-9]+)\\."_r;
-			if (std::regex_search(name, match, expr) &&
-			    FromChars{match[1]}(mib[1])) {
+			auto const [pos, len] = mib_index(name);
+			if (len && FromChars{&name[pos], &name[pos] + len}(mib[1])) {
 				std::scoped_lock const lock{this->mtx};
 				/* map name → mib */
 				this->mibs[name] = mib;
@@ -870,9 +928,12 @@ class Sysctls {
 	 *	The MIB of the base name
 	 */
 	mib_t const & getBaseMib(char const * const name) const {
+		std::string baseName{name};
+		auto const [pos, len] = mib_index(baseName);
+		if (len) {
+			baseName.replace(pos, len, "%d");
+		}
 		std::scoped_lock const lock{this->mtx};
-		auto const expr = "\\.([0-9]+)\\."_r;
-		auto const baseName = std::regex_replace(name, expr, ".%d.");
 		return this->mibs.at(baseName);
 	}
 
@@ -902,6 +963,490 @@ class Sysctls {
 	}
 } sysctls{}; /**< Sole instance of \ref Sysctls. */
 
+/**
+ * The default set of virtual paths.
+ */
+constexpr char const * const VFS_PATHS{"/proc/stat:/sys/devices/system/cpu/"};
+
+/**
+ * Emulates procfs and sysfs nodes from the sysctl store.
+ *
+ * Opening a virtual path opens /dev/null instead and registers the
+ * file descriptor. Reads from registered file descriptors are served
+ * from the sysctl store, writes update it. All other file descriptors
+ * are only checked against a lock free table of flags.
+ *
+ * | Node                                       | Source                     |
+ * |--------------------------------------------|----------------------------|
+ * | /proc/stat                                 | kern.cp_times              |
+ * | /sys/devices/system/cpu/{present,online}   | hw.ncpu                    |
+ * | cpufreq/{scaling,cpuinfo}_cur_freq         | dev.cpu.%d.freq            |
+ * | cpufreq/scaling_setspeed                   | dev.cpu.%d.freq, writable  |
+ * | cpufreq/scaling_available_frequencies      | dev.cpu.%d.freq_levels     |
+ * | cpufreq/{scaling,cpuinfo}_{min,max}_freq   | dev.cpu.%d.freq_levels     |
+ * | cpufreq/{related,affected}_cpus            | dev.cpu.%d.freq presence   |
+ * | cpufreq/scaling_driver                     | dev.cpufreq.%d.freq_driver |
+ * | cpufreq/scaling_governor                   | always `userspace`         |
+ *
+ * The cpufreq nodes are located in /sys/devices/system/cpu/cpu%d/.
+ * Cores without a dev.cpu.%d.freq sysctl belong to the clock domain
+ * of the preceding core with one. Frequencies are presented in kHz.
+ *
+ * The contents of a node are generated when reading from offset 0,
+ * like with seq_file(9) based nodes on Linux.
+ */
+class VirtualFiles {
+	private:
+	/**
+	 * The number of file descriptors that can be registered.
+	 */
+	static constexpr int const FDS{1024};
+
+	/**
+	 * Flags for registered file descriptors.
+	 */
+	std::atomic<bool> flags[FDS]{};
+
+	/**
+	 * A simple mutex.
+	 */
+	std::mutex mutable mtx;
+
+	/**
+	 * An open virtual file.
+	 */
+	struct node {
+		/**
+		 * The path of the node.
+		 */
+		std::string path;
+
+		/**
+		 * The contents of the node.
+		 */
+		std::string contents;
+
+		/**
+		 * The file position.
+		 */
+		size_t pos;
+	};
+
+	/**
+	 * Maps file descriptor → open virtual file.
+	 */
+	std::unordered_map<int, node> nodes;
+
+	/**
+	 * Maps the first core of a clock domain → the written
+	 * scaling_min_freq and scaling_max_freq in [MHz].
+	 */
+	std::unordered_map<int, std::pair<mhz_t, mhz_t>> limits;
+
+	/**
+	 * The path prefixes to emulate.
+	 *
+	 * Immutable after emulate() was called.
+	 */
+	std::vector<std::string> prefixes;
+
+	/**
+	 * Set by emulate() to publish the path prefixes.
+	 */
+	std::atomic<bool> emulated{false};
+
+	/**
+	 * Returns the first core of the clock domain of a core.
+	 *
+	 * @param core
+	 *	The core number
+	 * @return
+	 *	The first core with a dev.cpu.%d.freq sysctl up to the
+	 *	given core
+	 * @throws std::out_of_range
+	 *	If the core is not part of a clock domain
+	 */
+	static int leader(int core) {
+		char name[40];
+		for (; core >= 0; --core) {
+			sprintf_safe(name, FREQ, core);
+			try {
+				sysctls.getMib(name);
+				return core;
+			} catch (std::out_of_range &) {}
+		}
+		throw std::out_of_range{"core is not part of a clock domain"};
+	}
+
+	/**
+	 * Returns the recorded frequency levels of a core in [MHz].
+	 *
+	 * @param core
+	 *	The first core of a clock domain
+	 * @return
+	 *	The frequency levels
+	 */
+	static std::vector<mhz_t> levels(int const core) {
+		char name[40];
+		sprintf_safe(name, FREQ_LEVELS, core);
+		auto const str = sysctls[name].get<std::string>();
+		std::vector<mhz_t> result{};
+		auto fetch = FromChars{str};
+		for (mhz_t freq{0}; fetch(freq);) {
+			result.push_back(freq);
+			/* skip the power value */
+			for (; fetch && !std::isspace(*fetch.it); ++fetch.it);
+		}
+		if (result.empty()) {
+			throw std::out_of_range{"no frequency levels"};
+		}
+		return result;
+	}
+
+	/**
+	 * Returns the scaling_min_freq and scaling_max_freq of a clock
+	 * domain.
+	 *
+	 * The caller must hold the mutex.
+	 *
+	 * @param core
+	 *	The first core of a clock domain
+	 * @return
+	 *	The minimum and maximum clock frequency in [MHz]
+	 * @throws std::out_of_range
+	 *	If the core has no frequency levels
+	 */
+	std::pair<mhz_t, mhz_t> limit(int const core) const {
+		if (auto const it = this->limits.find(core);
+		    it != this->limits.end()) {
+			return it->second;
+		}
+		auto const freqs = levels(core);
+		return {*std::min_element(freqs.begin(), freqs.end()),
+		        *std::max_element(freqs.begin(), freqs.end())};
+	}
+
+	/**
+	 * Generate the contents of a node.
+	 *
+	 * The caller must hold the mutex.
+	 *
+	 * @param path
+	 *	The path of the node
+	 * @return
+	 *	The node contents
+	 * @throws std::out_of_range
+	 *	If the node does not exist in the emulation
+	 */
+	std::string generate(std::string const & path) const {
+		std::string result{};
+		if (path == "/proc/stat") {
+			auto const str = sysctls[CP_TIMES].get<std::string>();
+			std::vector<cptime_t> times{};
+			auto fetch = FromChars{str};
+			for (cptime_t ticks{0}; fetch(ticks); times.push_back(ticks));
+			cptime_t sum[CPUSTATES]{};
+			std::string cpus{};
+			for (size_t i = 0; i + CPUSTATES <= times.size(); i += CPUSTATES) {
+				auto const row = &times[i];
+				for (size_t state = 0; state < CPUSTATES; ++state) {
+					sum[state] += row[state];
+				}
+				cpus += "cpu%zu %lu %lu %lu %lu 0 %lu 0 0 0 0\n"_fmt
+				        (i / CPUSTATES, row[CP_USER], row[CP_NICE],
+				         row[CP_SYS], row[CP_IDLE], row[CP_INTR]);
+			}
+			return "cpu  %lu %lu %lu %lu 0 %lu 0 0 0 0\n"_fmt
+			       (sum[CP_USER], sum[CP_NICE], sum[CP_SYS],
+			        sum[CP_IDLE], sum[CP_INTR]) + cpus;
+		}
+		auto const ncpu = sysctls[{CTL_HW, HW_NCPU}].get<int>();
+		if (path == "/sys/devices/system/cpu/present" ||
+		    path == "/sys/devices/system/cpu/online") {
+			return "0-%d\n"_fmt(ncpu - 1);
+		}
+		int core{-1};
+		int end{0};
+		char attr[40]{};
+		if (std::sscanf(path.c_str(),
+		                "/sys/devices/system/cpu/cpu%d/cpufreq/%39s%n",
+		                &core, attr, &end) != 2 || path[end] ||
+		    core < 0 || core >= ncpu) {
+			throw std::out_of_range{"no such node"};
+		}
+		auto const first = leader(core);
+		char name[40];
+		if (!strcmp(attr, "scaling_cur_freq") ||
+		    !strcmp(attr, "cpuinfo_cur_freq") ||
+		    !strcmp(attr, "scaling_setspeed")) {
+			sprintf_safe(name, FREQ, first);
+			return "%d\n"_fmt(sysctls[name].get<mhz_t>() * 1000);
+		}
+		if (!strcmp(attr, "scaling_available_frequencies")) {
+			for (auto const freq : levels(first)) {
+				result += "%d "_fmt(freq * 1000);
+			}
+			result.back() = '\n';
+			return result;
+		}
+		if (!strcmp(attr, "scaling_min_freq")) {
+			return "%d\n"_fmt(limit(first).first * 1000);
+		}
+		if (!strcmp(attr, "scaling_max_freq")) {
+			return "%d\n"_fmt(limit(first).second * 1000);
+		}
+		if (!strcmp(attr, "cpuinfo_min_freq")) {
+			auto const freqs = levels(first);
+			return "%d\n"_fmt(*std::min_element(freqs.begin(), freqs.end()) * 1000);
+		}
+		if (!strcmp(attr, "cpuinfo_max_freq")) {
+			auto const freqs = levels(first);
+			return "%d\n"_fmt(*std::max_element(freqs.begin(), freqs.end()) * 1000);
+		}
+		if (!strcmp(attr, "related_cpus") ||
+		    !strcmp(attr, "affected_cpus")) {
+			for (int i = first; i < ncpu && leader(i) == first; ++i) {
+				result += "%d "_fmt(i);
+			}
+			result.back() = '\n';
+			return result;
+		}
+		if (!strcmp(attr, "scaling_driver")) {
+			sprintf_safe(name, FREQ_DRIVER, first);
+			return sysctls[name].get<std::string>() + '\n';
+		}
+		if (!strcmp(attr, "scaling_governor")) {
+			return "userspace\n";
+		}
+		throw std::out_of_range{"no such node"};
+	}
+
+	public:
+	/**
+	 * Set up the virtual paths.
+	 *
+	 * This may only be called once, the path prefixes are immutable
+	 * afterwards, so match() can access them without locking.
+	 *
+	 * @param paths
+	 *	A colon separated list of path prefixes to emulate
+	 */
+	void emulate(char const * paths) {
+		assert(!this->emulated.load(std::memory_order_relaxed));
+		for (auto it = paths; *it; it += *it == ':') {
+			auto const first = it;
+			for (; *it && *it != ':'; ++it);
+			if (it != first) {
+				this->prefixes.emplace_back(first, it);
+			}
+		}
+		this->emulated.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * Returns whether a path is emulated.
+	 *
+	 * This is lock free.
+	 *
+	 * @param path
+	 *	The path to check
+	 * @return
+	 *	Whether the path starts with one of the virtual path
+	 *	prefixes
+	 */
+	bool match(char const * const path) const {
+		if (!path || path[0] != '/' ||
+		    !this->emulated.load(std::memory_order_acquire)) {
+			return false;
+		}
+		for (auto const & prefix : this->prefixes) {
+			if (!std::strncmp(path, prefix.c_str(), prefix.size())) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Returns whether a file descriptor refers to a virtual file.
+	 *
+	 * This is lock free.
+	 *
+	 * @param fd
+	 *	The file descriptor
+	 * @return
+	 *	Whether the file descriptor is registered
+	 */
+	bool contains(int const fd) const {
+		return fd >= 0 && fd < FDS &&
+		       this->flags[fd].load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Register a file descriptor for a virtual path.
+	 *
+	 * @param fd
+	 *	The file descriptor to serve the node through
+	 * @param path
+	 *	The path of the node
+	 * @retval 0
+	 *	The file descriptor was registered
+	 * @retval -1
+	 *	The node does not exist (errno == ENOENT) or the file
+	 *	descriptor cannot be registered (errno == EMFILE)
+	 */
+	int add(int const fd, char const * const path) {
+		if (fd < 0 || fd >= FDS) {
+			return errno = EMFILE, -1;
+		}
+		std::scoped_lock const lock{this->mtx};
+		try {
+			generate(path);
+		} catch (std::out_of_range &) {
+			return errno = ENOENT, -1;
+		}
+		this->nodes[fd] = {path, "", 0};
+		this->flags[fd].store(true, std::memory_order_release);
+		return 0;
+	}
+
+	/**
+	 * Read from a virtual file.
+	 *
+	 * @param fd
+	 *	The registered file descriptor
+	 * @param buf,nbytes
+	 *	The destination buffer
+	 * @param offset
+	 *	The offset to read from, nullptr to read from the
+	 *	file position and advance it
+	 * @return
+	 *	The number of characters read
+	 * @retval -1
+	 *	The file descriptor is not registered (errno == EBADF)
+	 *	or the node vanished (errno == EIO)
+	 */
+	ssize_t read(int const fd, void * const buf, size_t const nbytes,
+	             off_t const * const offset) {
+		std::scoped_lock const lock{this->mtx};
+		auto const node = this->nodes.find(fd);
+		if (node == this->nodes.end()) {
+			return errno = EBADF, -1;
+		}
+		auto & file = node->second;
+		size_t const pos = offset ? *offset : file.pos;
+		if (pos == 0) {
+			try {
+				file.contents = generate(file.path);
+			} catch (std::out_of_range &) {
+				return errno = EIO, -1;
+			}
+		}
+		if (pos >= file.contents.size()) {
+			return 0;
+		}
+		auto const count = std::min(nbytes, file.contents.size() - pos);
+		std::memcpy(buf, &file.contents[pos], count);
+		if (!offset) {
+			file.pos += count;
+		}
+		return count;
+	}
+
+	/**
+	 * Write to a virtual file.
+	 *
+	 * Only cpufreq/scaling_setspeed, cpufreq/scaling_min_freq and
+	 * cpufreq/scaling_max_freq are writable. Like on Linux the
+	 * minimum and maximum are clamped to the frequency levels and
+	 * bound the clock frequency set through scaling_setspeed.
+	 *
+	 * @param fd
+	 *	The registered file descriptor
+	 * @param buf,nbytes
+	 *	The source buffer
+	 * @return
+	 *	The number of characters written
+	 * @retval -1
+	 *	The file descriptor is not registered (errno == EBADF),
+	 *	the node is not writable (errno == EACCES), the
+	 *	value is invalid (errno == EINVAL) or the node vanished
+	 *	(errno == ENOENT)
+	 */
+	ssize_t write(int const fd, void const * const buf,
+	              size_t const nbytes) {
+		std::scoped_lock const lock{this->mtx};
+		auto const node = this->nodes.find(fd);
+		if (node == this->nodes.end()) {
+			return errno = EBADF, -1;
+		}
+		auto const & path = node->second.path;
+		int core{-1};
+		int end{0};
+		char attr[40]{};
+		if (std::sscanf(path.c_str(),
+		                "/sys/devices/system/cpu/cpu%d/cpufreq/%39s%n",
+		                &core, attr, &end) != 2 || path[end]) {
+			return errno = EACCES, -1;
+		}
+		bool const setspeed = !strcmp(attr, "scaling_setspeed");
+		bool const min = !strcmp(attr, "scaling_min_freq");
+		bool const max = !strcmp(attr, "scaling_max_freq");
+		if (!setspeed && !min && !max) {
+			return errno = EACCES, -1;
+		}
+		auto const first = static_cast<char const *>(buf);
+		mhz_t freq{0};
+		if (!FromChars{first, first + nbytes}(freq)) {
+			return errno = EINVAL, -1;
+		}
+		freq /= 1000;
+		try {
+			auto const domain = leader(core);
+			char name[40];
+			sprintf_safe(name, FREQ, domain);
+			auto & ctl = sysctls[name];
+			if (setspeed) {
+				if (auto const it = this->limits.find(domain);
+				    it != this->limits.end()) {
+					freq = std::min(std::max(freq, it->second.first),
+					                it->second.second);
+				}
+				ctl.set(freq);
+				return nbytes;
+			}
+			auto const freqs = levels(domain);
+			auto const [lo, hi] =
+			    std::minmax_element(freqs.begin(), freqs.end());
+			freq = std::min(std::max(freq, *lo), *hi);
+			auto bounds = limit(domain);
+			(min ? bounds.first : bounds.second) = freq;
+			if (bounds.first > bounds.second) {
+				return errno = EINVAL, -1;
+			}
+			this->limits[domain] = bounds;
+			/* move the current clock frequency into the bounds */
+			auto const cur = ctl.get<mhz_t>();
+			ctl.set(std::min(std::max(cur, bounds.first), bounds.second));
+		} catch (std::out_of_range &) {
+			return errno = ENOENT, -1;
+		}
+		return nbytes;
+	}
+
+	/**
+	 * Unregister a file descriptor.
+	 *
+	 * @param fd
+	 *	The registered file descriptor
+	 */
+	void remove(int const fd) {
+		std::scoped_lock const lock{this->mtx};
+		this->flags[fd].store(false, std::memory_order_release);
+		this->nodes.erase(fd);
+	}
+} vfs{}; /**< Sole instance of \ref VirtualFiles. */
+
 /**
  * The reported state of a single CPU pipeline.
  */
@@ -947,28 +1492,42 @@ struct CoreFrameReport {
  */
 ofile<io::link>
 operator <<(ofile<io::link> fout, CoreFrameReport const & frame) {
-	return fout.printf(" %d %.1f %d %.1f",
-	                   frame.rec.freq, frame.rec.load * frame.rec.freq,
-	                   frame.run.freq, frame.run.load * frame.run.freq);
+	return fout.put(' ', frame.rec.freq,
+	                ' ', io::fixed<1>{frame.rec.load * frame.rec.freq},
+	                ' ', frame.run.freq,
+	                ' ', io::fixed<1>{frame.run.load * frame.run.freq});
 }
 
 /**
  * Provides a mechanism to provide frame wise per core load information.
+ *
+ * The output is flushed at most every FLUSH_INTERVAL instead of
+ * every frame.
  */
 class Report {
 	private:
+	/**
+	 * The maximum time between flushing the output.
+	 */
+	static constexpr ms const FLUSH_INTERVAL{250};
+
 	/**
 	 * The output stream to report to.
 	 */
 	ofile<io::link> fout;
 
+	/**
+	 * The time of the last output flush.
+	 */
+	std::chrono::steady_clock::time_point flushed{};
+
 	/**
 	 * The number of cpu cores to provide reports for.
 	 */
 	coreid_t const ncpu;
 
 	/**
-	 * The time passed in [ms].
+	 * The time passed in [µs].
 	 */
 	Sum<uint64_t> time;
 
@@ -985,9 +1544,12 @@ class Report {
 	 *	The stream to output to
 	 * @param ncpu
 	 *	The number of CPU cores to report
+	 * @param start
+	 *	The recording time the report starts at in [µs]
 	 */
-	Report(ofile<io::link> fout, coreid_t const ncpu) :
-	    fout{fout}, ncpu{ncpu}, time{}, cores{new CoreFrameReport[ncpu]{}} {
+	Report(ofile<io::link> fout, coreid_t const ncpu, uint64_t const start) :
+	    fout{fout}, ncpu{ncpu}, time{start},
+	    cores{new CoreFrameReport[ncpu]{}} {
 		fout.print("time[s]");
 		for (coreid_t i = 0; i < ncpu; ++i) {
 			fout.printf(" cpu.%d.rec.freq[MHz] cpu.%d.rec.load[MHz]"
@@ -995,6 +1557,14 @@ class Report {
 			            i, i, i, i);
 		}
 		fout.putc('\n').flush();
+		this->flushed = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * Flush the remaining output.
+	 */
+	~Report() {
+		this->fout.flush();
 	}
 
 	/**
@@ -1019,7 +1589,7 @@ class Report {
 		 * @param report
 		 *	The report this frame belongs to
 		 * @param duration
-		 *	The frame duration
+		 *	The frame duration in [µs]
 		 */
 		Frame(Report & report, uint64_t const duration) :
 		    report{report} {
@@ -1056,13 +1626,19 @@ class Report {
 		 * Finalises the frame by outputting it.
 		 */
 		~Frame() {
-			auto fout = this->report.fout;
-			fout.printf("%d.%03d", this->report.time / 1000,
-			            this->report.time % 1000);
-			for (coreid_t i = 0; i < this->report.ncpu; ++i) {
+			auto & report = this->report;
+			auto fout = report.fout;
+			/* truncate to ms */
+			fout.put(io::fixed<3>{report.time / 1000 / 1000.});
+			for (coreid_t i = 0; i < report.ncpu; ++i) {
 				fout << (*this)[i];
 			}
-			fout.putc('\n').flush();
+			fout.putc('\n');
+			auto const now = std::chrono::steady_clock::now();
+			if (now - report.flushed >= FLUSH_INTERVAL) {
+				fout.flush();
+				report.flushed = now;
+			}
 		}
 	};
 
@@ -1081,71 +1657,492 @@ class Report {
 };
 
 /**
- * Instances of this class represent an emulator session.
+ * The values of a single frame of the load recording.
+ */
+using frame_t = std::vector<cptime_t>;
+
+/**
+ * Reads the input line by line.
  *
- * This should be run in its own thread and expects the sysctl table
- * to be complete.
+ * Regular files are memory mapped and lines are served directly from
+ * the mapping without copying. Other inputs, like pipes, are streamed,
+ * lines have no length limit, the line buffer grows as required and
+ * is reused for all lines. The input is read in large chunks.
  */
-class Emulator {
+class LineReader {
 	private:
 	/**
-	 * The input data source.
+	 * The input file.
 	 */
 	ifile<io::link> fin;
 
 	/**
-	 * The output data sink.
+	 * The memory mapped input, empty if the input is streamed.
 	 */
-	ofile<io::link> fout;
+	io::mapping map;
 
 	/**
-	 * A reference to a bool that tells the emulator to die.
+	 * The beginning of the next line in the mapped input.
 	 */
-	bool const & die;
+	char const * it{nullptr};
 
 	/**
-	 * The size of the kern.cp_times buffer.
+	 * The read buffer for streamed input.
 	 */
-	size_t const size = sysctls[CP_TIMES].size();
+	std::vector<char> buf;
 
 	/**
-	 * The number of CPUs in kern.cp_times, may be greater than
-	 * the hw.ncpu value (e.g. if hyperthreading was turned off).
+	 * The beginning of the next line in the read buffer.
 	 */
-	int const ncpu = this->size / sizeof(cptime_t[CPUSTATES]);
+	size_t first{0};
 
 	/**
-	 * Per core information.
+	 * The end of the buffered input.
 	 */
-	struct Core {
-		/**
-		 * The sysctl handler.
-		 *
-		 * The constructor ensures this points to a valid handler.
-		 */
-		SysctlValue * freqCtl{nullptr};
+	size_t last{0};
 
-		/**
-		 * The clock frequency the simulation is running at.
-		 *
-		 * Updated at the end of frame and used in the next
-		 * frame.
-		 */
-		mhz_t runFreq{0};
+	/**
+	 * Set when the end of the streamed input was reached.
+	 */
+	bool eof{false};
 
-		/**
-		 * The recorded clock frequency.
-		 *
-		 * If FREQ_TRACKING is enabled this is updated at
-		 * during the preliminary stage and used at the beginning
-		 * of frame stage.
-		 */
-		mhz_t recFreq{0};
+	/**
+	 * Returns the end of the next buffered line.
+	 *
+	 * @return
+	 *	A pointer to the newline character
+	 * @retval nullptr
+	 *	No complete line is buffered
+	 */
+	char const * newline() const {
+		return static_cast<char const *>(
+		    std::memchr(this->buf.data() + this->first, '\n',
+		                this->last - this->first));
+	}
 
-		/**
-		 * The load cycles simulated for this frame in [cycles].
-		 *
-		 * This is determined at the beginning of frame and used
+	/**
+	 * Perform a single read() on the streamed input.
+	 *
+	 * This only blocks if no input is available. The buffer is
+	 * compacted and grown as necessary to make room for a line.
+	 */
+	void fill() {
+		if (this->first) {
+			std::memmove(this->buf.data(),
+			             this->buf.data() + this->first,
+			             this->last - this->first);
+			this->last -= this->first;
+			this->first = 0;
+		}
+		if (this->last == this->buf.size()) {
+			this->buf.resize(this->buf.size() * 2);
+		}
+		ssize_t len{-1};
+		while ((len = ::read(fileno(this->fin.get()),
+		                     this->buf.data() + this->last,
+		                     this->buf.size() - this->last)) < 0 &&
+		       errno == EINTR);
+		if (len <= 0) {
+			this->eof = true;
+			return;
+		}
+		this->last += len;
+	}
+
+	public:
+	/**
+	 * Construct a line reader.
+	 *
+	 * This maps the input file or reads it into its own buffer, so
+	 * no other operation may be performed on the file.
+	 *
+	 * @param fin
+	 *	The input file
+	 */
+	explicit LineReader(ifile<io::link> fin) :
+	    fin{fin}, map{io::file<io::link, io::mmap>{fin.get()}.map()} {
+		if (!this->map) {
+			this->buf.resize(BUFFER_SIZE);
+			return;
+		}
+		auto const pos = std::ftell(fin.get());
+		this->it = this->map.begin() +
+		           (pos > 0 ? std::min(size_t(pos), this->map.size()) : 0);
+	}
+
+	/**
+	 * Continue reading at the given input offset.
+	 *
+	 * @param offset
+	 *	The offset from the beginning of the input
+	 * @return
+	 *	Whether the input position was successfully changed
+	 */
+	bool seek(long const offset) {
+		if (this->map) {
+			if (offset < 0 || size_t(offset) > this->map.size()) {
+				return false;
+			}
+			this->it = this->map.begin() + offset;
+			return true;
+		}
+		if (lseek(fileno(this->fin.get()), offset, SEEK_SET) != offset) {
+			return false;
+		}
+		this->first = this->last = 0;
+		this->eof = false;
+		return true;
+	}
+
+	/**
+	 * Wait for a line to become available.
+	 *
+	 * Reading the next line does not block after this returned true.
+	 *
+	 * @param timeout
+	 *	The maximum time to wait for input in [ms]
+	 * @retval true
+	 *	A line or the end of input is available
+	 * @retval false
+	 *	The timeout expired
+	 */
+	bool ready(int const timeout) {
+		while (!this->map && !this->eof && !this->newline()) {
+			pollfd pfd{fileno(this->fin.get()), POLLIN, 0};
+			auto const events = ::poll(&pfd, 1, timeout);
+			if (events == 0 || (events < 0 && errno == EINTR)) {
+				return false;
+			}
+			if (events < 0) {
+				this->eof = true;
+				break;
+			}
+			this->fill();
+		}
+		return true;
+	}
+
+	/**
+	 * Read the next line.
+	 *
+	 * The line remains valid until the next line is read. It is
+	 * not zero terminated.
+	 *
+	 * @param end
+	 *	Set to the end of the line, excluding the newline
+	 * @return
+	 *	A pointer to the first character of the line
+	 * @retval nullptr
+	 *	The end of input was reached
+	 */
+	char const * operator ()(char const *& end) {
+		if (this->map) {
+			auto const first = this->it;
+			auto const last = this->map.end();
+			if (first == last) {
+				return nullptr;
+			}
+			auto const nl = static_cast<char const *>(
+			    std::memchr(first, '\n', last - first));
+			end = nl ? nl : last;
+			this->it = nl ? nl + 1 : last;
+			return first;
+		}
+		char const * nl{nullptr};
+		while (!(nl = this->newline()) && !this->eof) {
+			this->fill();
+		}
+		auto const line = this->buf.data() + this->first;
+		if (nl) {
+			end = nl;
+			this->first = nl + 1 - this->buf.data();
+			return line;
+		}
+		if (this->first == this->last) {
+			return nullptr;
+		}
+		end = this->buf.data() + this->last;
+		this->first = this->last;
+		return line;
+	}
+};
+
+/**
+ * Returns the beginning of a line for error messages.
+ *
+ * Lines are not zero terminated, so they cannot be printed directly.
+ *
+ * @param first,last
+ *	The character range to print from
+ * @return
+ *	Up to the first 8 characters of the range
+ */
+std::string excerpt(char const * const first, char const * const last) {
+	return {first, last - first > 8 ? first + 8 : last};
+}
+
+/**
+ * Parse a line of the load recording into a frame.
+ *
+ * The line is parsed in a single pass, parsing stops at the first
+ * invalid value.
+ *
+ * @param first,last
+ *	The line to parse
+ * @param frame
+ *	The frame to fill
+ */
+void parse(char const * const first, char const * const last,
+           frame_t & frame) {
+	/* every value takes at least two characters except the last */
+	frame.resize((last - first) / 2 + 1);
+	auto fetch = FromChars{first, last};
+	frame.resize(fetch(frame.data(), frame.size()));
+	if (fetch) {
+		warn("invalid value in frame at: %s ...\n",
+		     excerpt(fetch.it, last).c_str());
+	}
+}
+
+/**
+ * A bounded queue of frames for live input.
+ *
+ * Frames are pushed by a reader thread as they arrive, the reader
+ * never waits for the emulator, so the producer of the live input
+ * is not slowed down by the emulation.
+ *
+ * If the queue is full, the two oldest frames are merged into one.
+ * The merged frame covers the sum of both durations and contains the
+ * sum of the ticks, while the clock frequencies, temperatures and
+ * AC line state are taken from the newer frame. This bounds the
+ * memory use without losing load.
+ */
+class FrameQueue {
+	private:
+	/**
+	 * A simple mutex.
+	 */
+	std::mutex mutable mtx;
+
+	/**
+	 * Signals arriving frames and the end of input.
+	 */
+	std::condition_variable cond;
+
+	/**
+	 * The queued frames.
+	 */
+	std::deque<frame_t> frames;
+
+	/**
+	 * The maximum number of queued frames.
+	 */
+	size_t const capacity;
+
+	/**
+	 * The number of state values (clock frequencies, temperatures,
+	 * AC line state) following the duration in each frame.
+	 */
+	size_t const states;
+
+	/**
+	 * Set when no more frames will arrive.
+	 */
+	bool done{false};
+
+	/**
+	 * The number of frames merged due to overflow.
+	 */
+	size_t merged{0};
+
+	public:
+	/**
+	 * Construct a queue.
+	 *
+	 * @param capacity
+	 *	The maximum number of queued frames, at least 2
+	 * @param states
+	 *	The number of state values in a frame
+	 */
+	FrameQueue(size_t const capacity, size_t const states) :
+	    capacity{capacity > 1 ? capacity : 2}, states{states} {}
+
+	/**
+	 * Append a frame, merge the oldest frames on overflow.
+	 *
+	 * @param frame
+	 *	The frame to append
+	 */
+	void push(frame_t && frame) {
+		std::scoped_lock const lock{this->mtx};
+		while (this->frames.size() >= this->capacity) {
+			auto const & older = this->frames[0];
+			auto & newer = this->frames[1];
+			auto const size = std::min(older.size(), newer.size());
+			newer[0] += older[0];
+			for (size_t i = 1 + this->states; i < size; ++i) {
+				newer[i] += older[i];
+			}
+			this->frames.pop_front();
+			if (!this->merged++) {
+				warn("live input buffer overflow, merging frames\n");
+			}
+		}
+		this->frames.push_back(std::move(frame));
+		this->cond.notify_one();
+	}
+
+	/**
+	 * Retrieve the oldest frame.
+	 *
+	 * Blocks until a frame arrives or the queue is closed.
+	 *
+	 * @param frame
+	 *	The frame to assign to
+	 * @retval true
+	 *	A frame was retrieved
+	 * @retval false
+	 *	The queue was closed and no frames remain
+	 */
+	bool pop(frame_t & frame) {
+		std::unique_lock lock{this->mtx};
+		this->cond.wait(lock, [this]() {
+			return this->done || !this->frames.empty();
+		});
+		if (this->frames.empty()) {
+			return false;
+		}
+		frame = std::move(this->frames.front());
+		this->frames.pop_front();
+		return true;
+	}
+
+	/**
+	 * Signal the end of input.
+	 */
+	void close() {
+		std::scoped_lock const lock{this->mtx};
+		this->done = true;
+		this->cond.notify_all();
+	}
+
+	/**
+	 * Returns the number of frames merged due to overflow.
+	 *
+	 * @return
+	 *	The number of merged frames
+	 */
+	size_t overflows() const {
+		std::scoped_lock const lock{this->mtx};
+		return this->merged;
+	}
+};
+
+/**
+ * Instances of this class represent an emulator session.
+ *
+ * This should be run in its own thread and expects the sysctl table
+ * to be complete.
+ */
+class Emulator {
+	private:
+	/**
+	 * The input data source.
+	 */
+	std::shared_ptr<LineReader> lines;
+
+	/**
+	 * The output data sink.
+	 */
+	ofile<io::link> fout;
+
+	/**
+	 * A reference to a bool that tells the emulator to die.
+	 */
+	bool const & die;
+
+	/**
+	 * The live input queue, replaces reading fin if set.
+	 */
+	std::shared_ptr<FrameQueue> queue;
+
+	/**
+	 * The recording time of the first frame in [µs].
+	 */
+	uint64_t const start;
+
+	/**
+	 * The recording time to stop emulation at in [µs].
+	 */
+	uint64_t const end;
+
+	/**
+	 * The size of the kern.cp_times buffer.
+	 */
+	size_t const size = sysctls[CP_TIMES].size();
+
+	/**
+	 * The number of CPUs in kern.cp_times, may be greater than
+	 * the hw.ncpu value (e.g. if hyperthreading was turned off).
+	 */
+	int const ncpu = this->size / sizeof(cptime_t[CPUSTATES]);
+
+	/**
+	 * Per core information.
+	 */
+	struct Core {
+		/**
+		 * The sysctl handler.
+		 *
+		 * The constructor ensures this points to a valid handler.
+		 */
+		SysctlValue * freqCtl{nullptr};
+
+		/**
+		 * The clock frequency the simulation is running at.
+		 *
+		 * Updated at the end of frame and used in the next
+		 * frame.
+		 */
+		mhz_t runFreq{0};
+
+		/**
+		 * The recorded clock frequency.
+		 *
+		 * If FREQ_TRACKING is enabled this is updated at
+		 * during the preliminary stage and used at the beginning
+		 * of frame stage.
+		 */
+		mhz_t recFreq{0};
+
+		/**
+		 * The temperature sysctl handler.
+		 *
+		 * This is only set if the load record provides the
+		 * temperature of this core.
+		 */
+		SysctlValue * tempCtl{nullptr};
+
+		/**
+		 * The recorded temperature.
+		 *
+		 * If TEMP_TRACKING is enabled this is updated during
+		 * the preliminary stage and committed at the beginning
+		 * of frame stage.
+		 */
+		decikelvin_t recTemp{0};
+
+		/**
+		 * The recorded ticks of this frame.
+		 *
+		 * This is read at the beginning of frame.
+		 */
+		cptime_t recTicks[CPUSTATES]{};
+
+		/**
+		 * The load cycles simulated for this frame in [cycles].
+		 *
+		 * This is determined at the beginning of frame and used
 		 * to calculate the reported load at the end of frame.
 		 */
 		cycles_t runLoadCycles{0};
@@ -1170,11 +2167,52 @@ class Emulator {
 	 */
 	SysctlValue & cp_times = sysctls[CP_TIMES];
 
+	/**
+	 * The hw.acpi.acline sysctl handler.
+	 */
+	SysctlValue & acline = sysctls[ACLINE];
+
 	/**
 	 * The current kern.cp_times values.
 	 */
 	std::unique_ptr<cptime_t[]> sum{new cptime_t[CPUSTATES * ncpu]{}};
 
+	/**
+	 * The turbo table, pairs of active cores and the maximum clock
+	 * frequency, ordered by the number of active cores.
+	 */
+	std::vector<std::pair<coreid_t, mhz_t>> turbo{};
+
+	/**
+	 * The maximum clock frequency for the active cores of the
+	 * current frame.
+	 *
+	 * Shared with the clock frequency setters.
+	 */
+	std::shared_ptr<std::atomic<mhz_t>> limit{
+	    std::make_shared<std::atomic<mhz_t>>(
+	        std::numeric_limits<mhz_t>::max())};
+
+	/**
+	 * Returns the maximum clock frequency for the given number
+	 * of active cores.
+	 *
+	 * @param active
+	 *	The number of active cores
+	 * @return
+	 *	The clock frequency limit
+	 */
+	mhz_t turboLimit(coreid_t const active) const {
+		mhz_t result = std::numeric_limits<mhz_t>::max();
+		for (auto const & [cores, freq] : this->turbo) {
+			if (cores > active) {
+				break;
+			}
+			result = freq;
+		}
+		return result;
+	}
+
 	public:
 	/**
 	 * The constructor initialises all the members necessary for
@@ -1184,14 +2222,44 @@ class Emulator {
 	 *
 	 * @throws std::out_of_range
 	 *	In case one of the required sysctls is missing
-	 * @param fin,fout
+	 * @param lines,fout
 	 *	The character input and output streams
 	 * @param die
 	 *	If the referenced bool is true, emulation is terminated
 	 *	prematurely
-	 */
-	Emulator(ifile<io::link> fin, ofile<io::link> fout, bool const & die) :
-	    fin{fin}, fout{fout}, die{die} {
+	 * @param queue
+	 *	The live input queue, may be empty
+	 * @param start,end
+	 *	The replay window in recording time [µs], the input
+	 *	must be positioned at the frame starting at start
+	 */
+	Emulator(std::shared_ptr<LineReader> const & lines,
+	         ofile<io::link> fout, bool const & die,
+	         std::shared_ptr<FrameQueue> const & queue,
+	         uint64_t const start, uint64_t const end) :
+	    lines{lines}, fout{fout}, die{die}, queue{queue},
+	    start{start}, end{end} {
+		/* get the turbo table, empty unless in the load record */
+		if (auto const table = sysctls[TURBO_TABLE].get<std::string>();
+		    !table.empty()) {
+			auto fetch = FromChars{table};
+			auto msg = debug("emulate turbo limits:");
+			for (coreid_t cores{0}; fetch(cores);) {
+				mhz_t freq{0};
+				if (!fetch || *fetch.it != '/' ||
+				    (++fetch.it, !fetch(freq))) {
+					warn("ignoring invalid %s entry: %s\n",
+					     TURBO_TABLE, table.c_str());
+					this->turbo.clear();
+					break;
+				}
+				this->turbo.emplace_back(cores, freq);
+				msg.printf(" %d/%d", cores, freq);
+			}
+			msg.putc('\n');
+			std::sort(this->turbo.begin(), this->turbo.end());
+		}
+
 		/* get freq and freq_levels sysctls */
 		std::vector<mhz_t> freqLevels{};
 		for (coreid_t i = 0; i < this->ncpu; ++i) {
@@ -1220,9 +2288,8 @@ class Emulator {
 			/* get freq_levels */
 			sprintf_safe(name, FREQ_LEVELS, i);
 			try {
-				auto levels = sysctls[name]
-				              .get<std::string>();
-				levels = std::regex_replace(levels, "/[-+]?[0-9]*"_r, "");
+				auto const levels = sysctls[name]
+				                    .get<std::string>();
 				auto fetch = FromChars{levels};
 				freqLevels.clear();
 
@@ -1230,6 +2297,9 @@ class Emulator {
 				for (unsigned long level{0}; fetch(level);) {
 					freqLevels.push_back(level);
 					msg.printf(" %d", level);
+					/* skip the /power part */
+					for (; fetch && !std::isspace(*fetch.it); ++fetch.it);
+					for (; fetch && std::isspace(*fetch.it); ++fetch.it);
 				}
 				msg.putc('\n');
 			} catch (std::out_of_range &) {
@@ -1238,11 +2308,31 @@ class Emulator {
 				}
 			}
 
-			core.freqCtl->registerOnSet([freqLevels](SysctlValue & ctl) {
-				auto const freq = ctl.get<mhz_t>();
+			/*
+			 * Derive the clock frequency range like powerd++,
+			 * a single level (hwpstate) is the upper limit of
+			 * a continuous range.
+			 */
+			auto [lo, hi] = freqLevels.empty()
+			    ? std::pair{core.runFreq, core.runFreq}
+			    : std::pair{*std::min_element(freqLevels.begin(), freqLevels.end()),
+			                *std::max_element(freqLevels.begin(), freqLevels.end())};
+			auto levels = freqLevels;
+			if (lo == hi) {
+				lo = FREQ_DEFAULT_MIN;
+				levels.clear();
+			}
+
+			core.freqCtl->registerOnSet([levels, limit = this->limit](SysctlValue & ctl) {
+				/* the active cores limit the turbo levels */
+				auto const max = limit->load();
+				auto const freq = std::min(ctl.get<mhz_t>(), max);
 				auto result = freq;
 				auto diff = freq + 1000000;
-				for (auto lvl : freqLevels) {
+				for (auto lvl : levels) {
+					if (lvl > max) {
+						continue;
+					}
 					auto lvldiff = (lvl > freq ? lvl - freq : freq - lvl);
 					if (lvldiff < diff) {
 						diff = lvldiff;
@@ -1251,6 +2341,36 @@ class Emulator {
 				}
 				ctl.set(result);
 			});
+
+			/*
+			 * Emulate hardware P-states, map the
+			 * energy/performance preference onto the
+			 * frequency range.
+			 */
+			sprintf_safe(name, EPP, i);
+			try {
+				auto & eppCtl = sysctls[name];
+				auto const freqCtl = core.freqCtl;
+				debug("emulate core %d energy/performance preference: [%d MHz, %d MHz]\n",
+				      i, lo, hi);
+				eppCtl.registerOnSet([freqCtl, lo = lo, hi = hi](SysctlValue & ctl) {
+					auto const epp = std::clamp(ctl.get<int>(), 0, 100);
+					freqCtl->set(hi - (hi - lo) * epp / 100);
+				});
+			} catch (std::out_of_range &) {
+				/* not provided by the load record */
+			}
+		}
+
+		/* get temperature sysctls, set up by Main::Main() */
+		for (coreid_t i = 0; i < this->ncpu; ++i) {
+			char name[40];
+			sprintf_safe(name, TEMPERATURE, i);
+			try {
+				this->cores[i].tempCtl = &sysctls[name];
+			} catch (std::out_of_range &) {
+				/* not provided by the load record */
+			}
 		}
 
 		/* initialise kern.cp_times buffer */
@@ -1258,22 +2378,66 @@ class Emulator {
 		cp_times.get(this->sum.get(), size);
 	}
 
+	/**
+	 * Retrieve the next frame from the live input queue or input.
+	 *
+	 * Empty lines are skipped.
+	 *
+	 * @param frame
+	 *	The frame to assign to
+	 * @retval true
+	 *	A frame was retrieved
+	 * @retval false
+	 *	The end of input was reached
+	 */
+	bool next(frame_t & frame) {
+		if (this->queue) {
+			return this->queue->pop(frame);
+		}
+		char const * end{nullptr};
+		do {
+			auto const line = (*this->lines)(end);
+			if (!line) {
+				return false;
+			}
+			parse(line, end, frame);
+		} while (frame.empty());
+		return true;
+	}
+
 	/**
 	 * Performs load emulation and prints statistics on io::fout.
 	 *
-	 * Reads fin to pull in load changes and updates the
-	 * kern.cp_times sysctl to represent the current state.
+	 * Reads the input or the live input queue to pull in load changes
+	 * and updates the kern.cp_times sysctl to represent the current
+	 * state.
 	 *
 	 * When it runs out of load changes it terminates emulation
 	 * and sends a SIGINT to the process.
 	 */
 	void operator ()() try {
 		auto const features = sysctls[LOADREC_FEATURES].get<flag_t>();
-		Report report(this->fout, this->ncpu);
+		/* the frame duration unit relative to µs */
+		uint64_t const unit = features & 1_DURATION_US ? 1 : 1000;
+		Report report(this->fout, this->ncpu, this->start);
 
 		auto time = std::chrono::steady_clock::now();
-		for (uint64_t duration;
-		     !this->die && (1 == this->fin.scanf("%ju", duration));) {
+		frame_t values{};
+		/* live comparison of recorded and emulated clock decisions */
+		size_t frames{0};
+		size_t differ{0};
+		for (uint64_t elapsed = this->start;
+		     !this->die && elapsed < this->end && this->next(values);) {
+			/* read the frame values in order */
+			size_t column = 0;
+			auto const value = [&values, &column]() {
+				return column < values.size() ? values[column++] : 0;
+			};
+
+			/* frame duration in [µs] */
+			uint64_t const duration = value() * unit;
+			elapsed += duration;
+
 			/* setup new output frame */
 			auto frame = report.frame(duration);
 
@@ -1287,23 +2451,54 @@ class Emulator {
 
 				/* update recorded clock frequency */
 				if (features & 1_FREQ_TRACKING) {
-					this->fin.scanf("%u", core.recFreq);
+					core.recFreq = value();
 				}
 			}
 
+			/* get recorded core temperatures */
+			for (coreid_t i = 0;
+			     features & 1_TEMP_TRACKING && i < this->ncpu; ++i) {
+				this->cores[i].recTemp = value();
+			}
+
+			/* get recorded AC line state */
+			unsigned recAcline{0};
+			if (features & 1_ACLINE_TRACKING) {
+				recAcline = value();
+			}
+
 			/*
 			 * beginning of frame
 			 */
 
+			/* get recorded ticks and count the active cores */
+			double active{0};
+			for (coreid_t i = 0; i < this->ncpu; ++i) {
+				auto & core = this->cores[i];
+				cptime_t sumRecTicks{0};
+				for (auto & ticks : core.recTicks) {
+					ticks = value();
+					sumRecTicks += ticks;
+				}
+				if (sumRecTicks) {
+					active += double(sumRecTicks -
+					                 core.recTicks[CP_IDLE]) /
+					          sumRecTicks;
+				}
+			}
+			/* the turbo limit for the active cores */
+			mhz_t const limit =
+			    turboLimit(coreid_t(std::ceil(active)));
+			this->limit->store(limit);
+
 			/* calculate recorded load */
 			for (coreid_t i = 0; i < this->ncpu; ++i) {
 				auto & core = this->cores[i];
 
-				/* get recorded ticks */
-				cptime_t recTicks[CPUSTATES]{};
+				/* sum recorded ticks */
+				auto const & recTicks = core.recTicks;
 				cptime_t sumRecTicks{0};
-				for (auto & ticks : recTicks) {
-					this->fin.scanf("%lu", ticks);
+				for (auto const ticks : recTicks) {
 					sumRecTicks += ticks;
 				}
 				double const recLoadTicks =
@@ -1316,7 +2511,7 @@ class Emulator {
 
 				/* get recorded cycles in [cycles] */
 				cycles_t cycles[CPUSTATES]{};
-				cycles_t const runCycles = duration * core.recFreq * 1000;
+				cycles_t const runCycles = duration * core.recFreq;
 				for (size_t state = 0; state < CPUSTATES; ++state) {
 					cycles[state] = runCycles * recTicks[state] / sumRecTicks;
 				}
@@ -1328,7 +2523,8 @@ class Emulator {
 				}
 
 				/* determine simulation cycles at current freq */
-				cycles_t availableCycles = duration * core.runFreq * 1000;
+				cycles_t availableCycles =
+				    duration * std::min(core.runFreq, limit);
 				core.runLoadCycles = 0;
 				/* assign cycles in order of priority */
 				static_assert(CPUSTATES == 5, "All CPUSTATES must be implemented");
@@ -1365,10 +2561,20 @@ class Emulator {
 			}
 
 			/* commit changes */
+			for (coreid_t i = 0;
+			     features & 1_TEMP_TRACKING && i < this->ncpu; ++i) {
+				auto const & core = this->cores[i];
+				if (core.tempCtl) {
+					core.tempCtl->set(core.recTemp);
+				}
+			}
+			if (features & 1_ACLINE_TRACKING) {
+				this->acline.set(recAcline);
+			}
 			cp_times.set(&sum[0], this->size);
 
 			/* sleep */
-			std::this_thread::sleep_until(time += ms{duration});
+			std::this_thread::sleep_until(time += us{duration});
 
 			/*
 			 * end of frame
@@ -1378,15 +2584,30 @@ class Emulator {
 			for (coreid_t i = 0; i < this->ncpu; ++i) {
 				auto & core = this->cores[i];
 				core.runFreq = core.freqCtl->get<mhz_t>();
-				cycles_t const runCycles =
-				    duration * core.runFreq * 1000;
+				/* report the delivered clock frequency */
+				mhz_t const runFreq = std::min(core.runFreq, limit);
+				cycles_t const runCycles = duration * runFreq;
 				frame[i].run =
-				    {core.runFreq,
+				    {runFreq,
 				     runCycles
 				     ? static_cast<double>(core.runLoadCycles) /
 				       runCycles
 				     : 0};
+				differ += runFreq != core.recFreq;
 			}
+			frames += !!(features & 1_FREQ_TRACKING);
+		}
+
+		if (this->queue && (features & 1_FREQ_TRACKING)) {
+			io::ferr.printf("libloadplay: live: %zu frames, "
+			                "%zu of %zu clock decisions differ "
+			                "from the recording, %zu frames merged\n",
+			                frames, differ, frames * this->ncpu,
+			                this->queue->overflows());
+		}
+		if (this->queue && this->queue->overflows()) {
+			warn("merged %zu frames due to live input buffer overflow\n",
+			     this->queue->overflows());
 		}
 
 		/* tell process to die */
@@ -1430,6 +2651,106 @@ class Main {
 	 */
 	bool die{false};
 
+	/**
+	 * The live input queue.
+	 */
+	std::shared_ptr<FrameQueue> queue;
+
+	/**
+	 * The live input reader thread.
+	 */
+	std::thread reader;
+
+	/**
+	 * Skip the input up to the beginning of the replay window.
+	 *
+	 * If a frame index is provided, the input is moved to the last
+	 * checkpoint before the start of the window. The remaining
+	 * frames up to the start are skipped, accumulating their ticks.
+	 * Finally kern.cp_times is initialised with the accumulated
+	 * state.
+	 *
+	 * @param lines
+	 *	The input, positioned behind the first frame
+	 * @param time
+	 *	Set to the recording time the replay starts at in [µs]
+	 * @param start
+	 *	The start of the replay window in [µs]
+	 * @param ticks
+	 *	The column of the first tick value in a frame
+	 * @param unit
+	 *	The frame duration unit in [µs]
+	 * @retval true
+	 *	The input is positioned at the first frame of the window
+	 * @retval false
+	 *	Seeking failed, an error was printed
+	 */
+	static bool skip(LineReader & lines, uint64_t & time,
+	                 uint64_t const start, size_t const ticks,
+	                 uint64_t const unit) {
+		auto & cp_times = sysctls[CP_TIMES];
+		frame_t state(cp_times.size() / sizeof(cptime_t));
+		auto size = state.size() * sizeof(cptime_t);
+		cp_times.get(state.data(), size);
+
+		char const * line{nullptr};
+		char const * end{nullptr};
+		frame_t frame{};
+
+		/* resume from the last checkpoint before start */
+		auto const & env = sys::env::vars;
+		if (env["LOADPLAY_INDEX"]) {
+			ifile<io::own> findex{env["LOADPLAY_INDEX"], "rb"};
+			if (!findex) {
+				fail("failed to open index file %s\n",
+				     env["LOADPLAY_INDEX"].c_str());
+				return false;
+			}
+			long offset{-1};
+			LineReader index{findex};
+			while ((line = index(end))) {
+				parse(line, end, frame);
+				if (frame.size() != 2 + state.size()) {
+					fail("frame index does not match the load record: %s ...\n", excerpt(line, end).c_str());
+					return false;
+				}
+				if (frame[0] > start) {
+					break;
+				}
+				time = frame[0];
+				offset = frame[1];
+				std::copy(frame.begin() + 2, frame.end(), state.begin());
+			}
+			if (offset >= 0 && !lines.seek(offset)) {
+				fail("failed to seek input to offset %ld\n", offset);
+				return false;
+			}
+			debug("resume from checkpoint at %ju us\n", time);
+		}
+
+		/* fast forward to start */
+		while (time < start && (line = lines(end))) {
+			parse(line, end, frame);
+			if (frame.empty()) {
+				continue;
+			}
+			if (frame.size() != ticks + state.size()) {
+				fail("unexpected number of columns in frame: %s ...\n", excerpt(line, end).c_str());
+				return false;
+			}
+			time += frame[0] * unit;
+			for (size_t i = 0; i < state.size(); ++i) {
+				state[i] += frame[ticks + i];
+			}
+		}
+
+		/* initialise kern.cp_times */
+		cp_times.set(state.data(), state.size() * sizeof(cptime_t));
+		debug("sysctl %s = %s\n", CP_TIMES,
+		      cp_times.get<std::string>().c_str());
+		return true;
+	}
+
 	public:
 	/**
 	 * The constructor starts up the emulation.
@@ -1449,21 +2770,24 @@ class Main {
 			return;
 		}
 
-		char inbuf[16384]{};
-		std::cmatch match;
+		auto const lines = std::make_shared<LineReader>(fin);
+		char const * eol{nullptr};
+		auto line = (*lines)(eol);
 
-		/* get static sysctls */
-		auto const expr = "([^=]*)=(.*)\n"_r;
-		if (!fin.gets(inbuf)) {
+		/* get static sysctls, name=value pairs up to the first frame */
+		if (!line) {
 			fail("cannot read from input\n");
 			return;
 		}
-		while (std::regex_match(inbuf, match, expr)) {
-			sysctls.addValue(match[1].str(), match[2].str());
-			debug("sysctl %s = %s\n",
-			      match[1].str().c_str(), match[2].str().c_str());
-			if (!fin.gets(inbuf)) {
-				fail("unexpected end of input behind: %s", inbuf);
+		for (char const * eq{nullptr};
+		     (eq = static_cast<char const *>(std::memchr(line, '=', eol - line)));) {
+			std::string const name{line, eq};
+			std::string const value{eq + 1, eol};
+			sysctls.addValue(name, value);
+			debug("sysctl %s = %s\n", name.c_str(), value.c_str());
+			if (!(line = (*lines)(eol))) {
+				fail("unexpected end of input behind: %s=%s\n",
+				     name.c_str(), value.c_str());
 				return;
 			}
 		}
@@ -1509,9 +2833,9 @@ class Main {
 		}
 
 		/* skip frame time */
-		auto fetch = FromChars{inbuf};
+		auto fetch = FromChars{line, eol};
 		if (uint64_t time{1}; !fetch(time) || time != 0) {
-			fail("first frame time must be 0: %.8s\n", inbuf);
+			fail("first frame time must be 0: %s\n", excerpt(line, eol).c_str());
 			return;
 		}
 
@@ -1519,14 +2843,17 @@ class Main {
 		size_t columns = 0;
 		auto seek = fetch;
 		for (cptime_t val{0}; seek(val); ++columns);
-		coreid_t const cores = columns / (CPUSTATES + !!(features & 1_FREQ_TRACKING));
+		size_t const aclines = !!(features & 1_ACLINE_TRACKING);
+		coreid_t const cores = (columns - aclines) /
+		                       (CPUSTATES + !!(features & 1_FREQ_TRACKING) +
+		                        !!(features & 1_TEMP_TRACKING));
 
 		/* check reference frequencies */
 		for (coreid_t i = 0;
 		     features & 1_FREQ_TRACKING && i < cores; ++i) {
 			mhz_t freq{0};
 			if (!fetch(freq)) {
-				fail("unable to parse core frequency from record at: %.8s ...\n", fetch.it);
+				fail("unable to parse core frequency from record at: %s ...\n", excerpt(fetch.it, eol).c_str());
 				return;
 			}
 			if (freq <= 0) {
@@ -1535,15 +2862,68 @@ class Main {
 			}
 		}
 
+		/* initialise core temperatures */
+		for (coreid_t i = 0;
+		     features & 1_TEMP_TRACKING && i < cores; ++i) {
+			decikelvin_t temp{0};
+			if (!fetch(temp)) {
+				fail("unable to parse core temperature from record at: %s ...\n", excerpt(fetch.it, eol).c_str());
+				return;
+			}
+			sprintf_safe(name, TEMPERATURE, i);
+			sysctls.addValue(std::string{name}, std::to_string(temp));
+		}
+
+		/* initialise hw.acpi.acline */
+		if (aclines) {
+			unsigned acline{0};
+			if (!fetch(acline)) {
+				fail("unable to parse AC line state from record at: %s ...\n", excerpt(fetch.it, eol).c_str());
+				return;
+			}
+			sysctls.addValue(std::string{ACLINE}, std::to_string(acline));
+		}
+
 		/* initialise kern.cp_times */
 		try {
-			sysctls.addValue(std::string{CP_TIMES}, fetch.it);
-			debug("sysctl %s = %s", CP_TIMES, fetch.it);
+			std::string const value{fetch.it, eol};
+			sysctls.addValue(std::string{CP_TIMES}, value);
+			debug("sysctl %s = %s", CP_TIMES, value.c_str());
 		} catch (std::out_of_range &) {
 			fail("kern.cp_times cannot be set, please check your load record\n");
 			return;
 		}
 
+		/* get the replay window */
+		uint64_t start{0};
+		uint64_t end{std::numeric_limits<uint64_t>::max()};
+		auto const window = [](char const * const var,
+		                       char const * const value, uint64_t & dst) {
+			if (!value) {
+				return true;
+			}
+			std::string const str{value};
+			uint64_t time{0};
+			if (!FromChars{str}(time)) {
+				fail("%s must be a time in ms: %s\n", var, value);
+				return false;
+			}
+			dst = time * 1000;
+			return true;
+		};
+		if (!window("LOADPLAY_START", env["LOADPLAY_START"], start) ||
+		    !window("LOADPLAY_END", env["LOADPLAY_END"], end)) {
+			return;
+		}
+
+		/* seek to the start of the replay window */
+		uint64_t time{0};
+		if (start && !skip(*lines, time, start,
+		                   columns - cores * CPUSTATES + 1,
+		                   features & 1_DURATION_US ? 1 : 1000)) {
+			return;
+		}
+
 		/* check output character stream */
 		ofile<io::link> fout{io::fout};
 		if (env["LOADPLAY_OUT"] &&
@@ -1552,11 +2932,50 @@ class Main {
 			     env["LOADPLAY_OUT"].c_str());
 			return;
 		}
+		if (env["LOADPLAY_OUT"]) {
+			fout.buffer(BUFFER_SIZE);
+		}
+
+		/* set up virtual procfs and sysfs nodes */
+		vfs.emulate(env["LOADPLAY_VFS"] ? env["LOADPLAY_VFS"].c_str()
+		                                : VFS_PATHS);
+
+		/* start live input reader */
+		if (env["LOADPLAY_LIVE"]) {
+			std::string const live{env["LOADPLAY_LIVE"].c_str()};
+			size_t capacity{0};
+			if (!FromChars{live}(capacity) || !capacity) {
+				fail("LOADPLAY_LIVE must be a positive frame count: %s\n",
+				     live.c_str());
+				return;
+			}
+			this->queue = std::make_shared<FrameQueue>(
+			    capacity, columns - cores * CPUSTATES);
+			this->reader = std::thread{[lines, queue = this->queue,
+			                            &die = this->die]() {
+				char const * end{nullptr};
+				for (char const * line{nullptr}; !die;) {
+					if (!lines->ready(LIVE_POLL_TIMEOUT)) {
+						continue;
+					}
+					if (!(line = (*lines)(end))) {
+						break;
+					}
+					frame_t frame{};
+					parse(line, end, frame);
+					if (!frame.empty()) {
+						queue->push(std::move(frame));
+					}
+				}
+				queue->close();
+			}};
+		}
 
 		/* start background thread */
 		try {
 			this->bgthread =
-			    std::thread{Emulator{fin, fout, this->die}};
+			    std::thread{Emulator{lines, fout, this->die, this->queue,
+			                         time, end}};
 			sysctl_startup = false;
 		} catch (std::out_of_range &) {
 			fail("failed to start emulator thread\n");
@@ -1569,6 +2988,13 @@ class Main {
 	 */
 	~Main() {
 		this->die = true;
+		if (this->queue) {
+			this->queue->close();
+		}
+		/* the reader polls the input and notices die in time */
+		if (this->reader.joinable()) {
+			this->reader.join();
+		}
 		if (this->bgthread.joinable()) {
 			this->bgthread.join();
 		}
@@ -1727,6 +3153,189 @@ int sysctlnametomib(const char * name, int * mibp, size_t * sizep) {
 	return sys_result(orig(name, mibp, sizep));
 }
 
+/**
+ * Intercept calls to open().
+ *
+ * Virtual procfs and sysfs paths are served by
+ * \ref anonymous_namespace{libloadplay.cpp}::vfs, the returned
+ * file descriptor refers to /dev/null.
+ *
+ * @param path,flags
+ *	Please refer to open(2)
+ * @return
+ *	A file descriptor
+ * @retval -1
+ *	The call failed
+ */
+int open(char const * path, int flags, ...) {
+	static auto const orig = (decltype(&open))dlfunc(RTLD_NEXT, "open");
+	int mode{0};
+	if (flags & O_CREAT) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, int);
+		va_end(ap);
+	}
+
+	/* fallback to the system for regular files */
+	if (sysctl_startup || !vfs.match(path)) {
+		return orig(path, flags, mode);
+	}
+
+	/* try virtual files */
+	auto const fd = orig("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+	if (fd != -1 && vfs.add(fd, path) == -1) {
+		auto const err = errno;
+		close(fd);
+		dprintf("open(%s) [sim] -> ENOENT\n", path);
+		return errno = err, -1;
+	}
+	dprintf("open(%s) [sim]\n", path);
+	return fd;
+}
+
+/**
+ * Intercept calls to openat().
+ *
+ * Absolute virtual paths are served like with open().
+ *
+ * @param fd,path,flags
+ *	Please refer to open(2)
+ * @return
+ *	A file descriptor
+ * @retval -1
+ *	The call failed
+ */
+int openat(int fd, char const * path, int flags, ...) {
+	static auto const orig = (decltype(&openat))dlfunc(RTLD_NEXT, "openat");
+	int mode{0};
+	if (flags & O_CREAT) {
+		va_list ap;
+		va_start(ap, flags);
+		mode = va_arg(ap, int);
+		va_end(ap);
+	}
+
+	/* fallback to the system for regular files */
+	if (sysctl_startup || !vfs.match(path)) {
+		return orig(fd, path, flags, mode);
+	}
+	return open(path, flags, mode);
+}
+
+/**
+ * Intercept calls to read().
+ *
+ * @param fd,buf,nbytes
+ *	Please refer to read(2)
+ * @return
+ *	The number of characters read
+ * @retval -1
+ *	The call failed
+ */
+ssize_t read(int fd, void * buf, size_t nbytes) {
+	static auto const orig = (decltype(&read))dlfunc(RTLD_NEXT, "read");
+	if (vfs.contains(fd)) {
+		return vfs.read(fd, buf, nbytes, nullptr);
+	}
+	return orig(fd, buf, nbytes);
+}
+
+/**
+ * Intercept calls to pread().
+ *
+ * @param fd,buf,nbytes,offset
+ *	Please refer to pread(2)
+ * @return
+ *	The number of characters read
+ * @retval -1
+ *	The call failed
+ */
+ssize_t pread(int fd, void * buf, size_t nbytes, off_t offset) {
+	static auto const orig = (decltype(&pread))dlfunc(RTLD_NEXT, "pread");
+	if (vfs.contains(fd)) {
+		return vfs.read(fd, buf, nbytes, &offset);
+	}
+	return orig(fd, buf, nbytes, offset);
+}
+
+/**
+ * Intercept calls to write().
+ *
+ * @param fd,buf,nbytes
+ *	Please refer to write(2)
+ * @return
+ *	The number of characters written
+ * @retval -1
+ *	The call failed
+ */
+ssize_t write(int fd, void const * buf, size_t nbytes) {
+	static auto const orig = (decltype(&write))dlfunc(RTLD_NEXT, "write");
+	if (vfs.contains(fd)) {
+		return vfs.write(fd, buf, nbytes);
+	}
+	return orig(fd, buf, nbytes);
+}
+
+/**
+ * Intercept calls to pwrite().
+ *
+ * Virtual files are written as a whole, the offset is ignored.
+ *
+ * @param fd,buf,nbytes,offset
+ *	Please refer to pwrite(2)
+ * @return
+ *	The number of characters written
+ * @retval -1
+ *	The call failed
+ */
+ssize_t pwrite(int fd, void const * buf, size_t nbytes, off_t offset) {
+	static auto const orig = (decltype(&pwrite))dlfunc(RTLD_NEXT, "pwrite");
+	if (vfs.contains(fd)) {
+		return vfs.write(fd, buf, nbytes);
+	}
+	return orig(fd, buf, nbytes, offset);
+}
+
+/**
+ * Intercept calls to ftruncate().
+ *
+ * Virtual files have no size to truncate, this always succeeds
+ * for them.
+ *
+ * @param fd,length
+ *	Please refer to ftruncate(2)
+ * @retval 0
+ *	The call succeeded
+ * @retval -1
+ *	The call failed
+ */
+int ftruncate(int fd, off_t length) {
+	static auto const orig = (decltype(&ftruncate))dlfunc(RTLD_NEXT, "ftruncate");
+	if (vfs.contains(fd)) {
+		return 0;
+	}
+	return orig(fd, length);
+}
+
+/**
+ * Intercept calls to close().
+ *
+ * @param fd
+ *	Please refer to close(2)
+ * @retval 0
+ *	The call succeeded
+ * @retval -1
+ *	The call failed
+ */
+int close(int fd) {
+	static auto const orig = (decltype(&close))dlfunc(RTLD_NEXT, "close");
+	if (vfs.contains(fd)) {
+		vfs.remove(fd);
+	}
+	return orig(fd);
+}
+
 /**
  * Intercept calls to daemon().
  *
@@ -0,0 +1,349 @@
+/**
+ * Implements loadjournal, a converter for powerd++ journals.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+#include "Journal.hpp"
+
+#include "errors.hpp"
+#include "utility.hpp"
+
+#include "sys/io.hpp"
+
+#include <vector> /* std::vector */
+
+#include <cinttypes> /* PRIu64 */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+namespace io = sys::io;
+
+using utility::to_value;
+using namespace utility::literals;
+
+using namespace std::literals::string_literals;
+
+/**
+ * Output file type alias.
+ *
+ * @tparam Ownership
+ *	The io::ownership type of the file
+ */
+template <auto Ownership> using ofile = io::file<Ownership, io::write>;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,              /**< Print help */
+	FILE_OUT,           /**< Set output file instead of stdout */
+	FILE_DECISIONS,     /**< Set the decisions output file */
+	FILE_IN,            /**< An input file */
+	OPT_NOOPT = FILE_IN, /**< Obligatory */
+	OPT_UNKNOWN,        /**< Obligatory */
+	OPT_DASH,           /**< Obligatory */
+	OPT_LDASH,          /**< Obligatory */
+	OPT_DONE            /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-h] [-o file] [-d file] file [...]";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,          'h', "help",      "",           "Show usage and exit"},
+	{OE::FILE_OUT,       'o', "output",    "file",       "Output file (load recording)"},
+	{OE::FILE_DECISIONS, 'd', "decisions", "file",       "Output file (clock frequency decisions)"},
+	{OE::FILE_IN,         0 , "",          "file,[...]", "Input files (powerd++ journal)"},
+};
+
+/**
+ * Open an output file.
+ *
+ * @param name
+ *	The file name
+ * @return
+ *	The opened file
+ * @throws errors::Exception{Exit::EWOPEN}
+ *	If the file cannot be opened
+ */
+ofile<io::own> open(char const * const name) {
+	ofile<io::own> file{name, "wb"};
+	if (!file) {
+		fail(Exit::EWOPEN, errno,
+		     "could not open file for writing: "s + name);
+	}
+	return file;
+}
+
+/**
+ * Converts journal files into a load recording and a list of
+ * decisions.
+ */
+class Converter {
+	private:
+	/**
+	 * The load recording output.
+	 */
+	ofile<io::link> fout;
+
+	/**
+	 * The decisions output.
+	 */
+	ofile<io::link> fdecisions;
+
+	/**
+	 * The header of the first journal.
+	 */
+	journal::Header head{};
+
+	/**
+	 * The core group of every core.
+	 */
+	std::vector<uint16_t> groups;
+
+	/**
+	 * The values of the current record.
+	 */
+	std::vector<uint64_t> values;
+
+	/**
+	 * The number of converted records.
+	 */
+	size_t count{0};
+
+	/**
+	 * The time of the current record in µs.
+	 */
+	uint64_t time{0};
+
+	/**
+	 * Write the headers of both outputs.
+	 *
+	 * @param jin
+	 *	The first journal
+	 */
+	void start(journal::Reader const & jin) {
+		this->head = jin.header();
+		this->groups.assign(jin.groups(), jin.groups() + head.ncpu);
+		for (auto const group : this->groups) {
+			if (group >= head.ngroups) {
+				fail(Exit::EFILE, 0, "core group out of range");
+			}
+		}
+		this->fout.write(jin.sysctls(), head.sysctls);
+
+		this->fdecisions.print("# ");
+		this->fdecisions.write(jin.args(), head.args);
+		this->fdecisions.print("\ntime[s]");
+		for (size_t i = 0; i < head.ngroups; ++i) {
+			this->fdecisions.printf(" cpu.%d.freq[MHz]",
+			                        jin.corei()[i]);
+		}
+		this->fdecisions.putc('\n');
+	}
+
+	public:
+	/**
+	 * Construct a converter.
+	 *
+	 * @param fout
+	 *	The load recording output
+	 * @param fdecisions
+	 *	The decisions output
+	 */
+	Converter(ofile<io::link> fout, ofile<io::link> fdecisions) :
+	    fout{fout}, fdecisions{fdecisions} {}
+
+	/**
+	 * Convert a journal file.
+	 *
+	 * Rotated journals can be converted in sequence, oldest first.
+	 * If a journal starts a new run, its first record contains
+	 * absolute kern.cp_times values instead of their growth, so
+	 * it is skipped unless it is the first record of the recording.
+	 *
+	 * @param name
+	 *	The journal file name
+	 * @throws errors::Exception{Exit::EFILE}
+	 *	If the file is not a journal or does not match the
+	 *	previous journals
+	 */
+	void operator ()(char const * const name) {
+		journal::Reader jin{
+		    io::file<io::own, io::mmap>{name, "rb"}.map()};
+		if (!jin) {
+			fail(Exit::EFILE, errno,
+			     "%s: powerd++ journal expected"_fmt(name));
+		}
+		auto const & head = jin.header();
+		if (!this->count) {
+			start(jin);
+		} else if (head.ncpu != this->head.ncpu ||
+		           head.ngroups != this->head.ngroups ||
+		           head.states != this->head.states ||
+		           (head.flags ^ this->head.flags) & ~journal::START) {
+			fail(Exit::EFILE, 0,
+			     "%s: journal does not match the previous journals"_fmt
+			     (name));
+		}
+
+		size_t const ngroups = head.ngroups;
+		size_t const ncpu = head.ncpu;
+		this->values.resize(2 + 3 * ngroups + ncpu * head.states);
+		/* a new run cannot continue the recording */
+		bool reset = this->count && (head.flags & journal::START);
+		while (jin.next()) {
+			for (auto & value : this->values) {
+				if (!jin(value)) {
+					fail(Exit::EFILE, 0,
+					     "%s: corrupt journal record"_fmt(name));
+				}
+			}
+			if (reset) {
+				reset = false;
+				continue;
+			}
+			auto const * it = this->values.data();
+			/* the first frame of a recording has no duration */
+			auto const duration = this->count++ ? *it : 0;
+			auto const acline = *++it;
+			auto const * const group = ++it;
+			auto const * const ticks = group + 3 * ngroups;
+
+			/* load recording frame */
+			this->fout.put(duration);
+			for (size_t i = 0; i < ncpu; ++i) {
+				this->fout.put(' ', group[3 * this->groups[i]]);
+			}
+			for (size_t i = 0; head.flags & journal::TEMPERATURE &&
+			                   i < ncpu; ++i) {
+				this->fout.put(' ', group[3 * this->groups[i] + 1]);
+			}
+			this->fout.put(' ', acline);
+			for (size_t i = 0; i < ncpu * head.states; ++i) {
+				this->fout.put(' ', ticks[i]);
+			}
+			this->fout.putc('\n');
+
+			/* decisions */
+			this->time += duration;
+			this->fdecisions.printf("%" PRIu64 ".%06" PRIu64,
+			                        this->time / 1000000,
+			                        this->time % 1000000);
+			for (size_t i = 0; i < ngroups; ++i) {
+				this->fdecisions.put(' ', group[3 * i + 2]);
+			}
+			this->fdecisions.putc('\n');
+		}
+	}
+
+	/**
+	 * Returns the number of converted records.
+	 *
+	 * @return
+	 *	The number of records
+	 */
+	size_t records() const {
+		return this->count;
+	}
+};
+
+} /* namespace */
+
+/**
+ * Parse command line arguments and convert the given journals.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	std::vector<char const *> infiles;
+	ofile<io::own> outfile{};
+	ofile<io::own> decisionsfile{};
+	bool done{false};
+	try {
+		while (!done) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FILE_OUT:
+			outfile = open(getopt[1]);
+			break;
+		case OE::FILE_DECISIONS:
+			decisionsfile = open(getopt[1]);
+			break;
+		case OE::FILE_IN:
+			infiles.push_back(getopt[0]);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+			break;
+		case OE::OPT_DONE:
+			if (infiles.empty()) {
+				fail(Exit::ECLARG, 0, "journal file expected");
+			}
+			done = true;
+			break;
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FILE_OUT:
+		case OE::FILE_DECISIONS:
+			e.msg += "\n\n"s += getopt.show(1);
+			break;
+		case OE::FILE_IN:
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+		case OE::OPT_DONE:
+			e.msg += "\n\n"s += getopt.show(0);
+			break;
+		}
+		throw;
+	}
+
+	Converter convert{outfile ? ofile<io::link>{outfile.get()} : io::fout,
+	                  ofile<io::link>{decisionsfile.get()}};
+	for (auto const name : infiles) {
+		convert(name);
+	}
+	if (!convert.records()) {
+		fail(Exit::EFILE, 0, "the journal contains no records");
+	}
+	return to_value(Exit::OK);
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("loadjournal: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("loadjournal: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
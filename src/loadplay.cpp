@@ -8,6 +8,7 @@
 
 #include "errors.hpp"
 #include "utility.hpp"
+#include "clas.hpp"
 
 #include "sys/env.hpp"
 #include "sys/io.hpp"
@@ -29,6 +30,7 @@ using errors::fail;
 namespace io = sys::io;
 
 using utility::to_value;
+using clas::ival;
 using namespace utility::literals;
 
 using namespace std::literals::string_literals;
@@ -40,6 +42,10 @@ enum class OE {
 	USAGE,            /**< Print help */
 	FILE_IN,          /**< Set input file instead of stdin */
 	FILE_OUT,         /**< Set output file instead of stdout */
+	CNT_LIVE,         /**< Live input with the given buffer size */
+	IVAL_START,       /**< Set the replay window start */
+	IVAL_END,         /**< Set the replay window end */
+	FILE_INDEX,       /**< Set the frame index file */
 	CMD,              /**< The command to execute */
 	OPT_NOOPT = CMD,  /**< Obligatory */
 	OPT_UNKNOWN,      /**< Obligatory */
@@ -51,16 +57,20 @@ enum class OE {
 /**
  * The short usage string.
  */
-char const * const USAGE = "[-h] [-i file] [-o file] command [...]";
+char const * const USAGE = "[-h] [-i file] [-o file] [-l cnt] [-s ival] [-e ival] [-I file] command [...]";
 
 /**
  * Definitions of command line parameters.
  */
 Parameter<OE> const PARAMETERS[]{
-	{OE::USAGE,    'h', "help",   "",              "Show usage and exit"},
-	{OE::FILE_IN,  'i', "input",  "file",          "Input file (load recording)"},
-	{OE::FILE_OUT, 'o', "output", "file",          "Output file (replay stats)"},
-	{OE::CMD,       0 , "",       "command,[...]", "The command to execute"},
+	{OE::USAGE,      'h', "help",   "",              "Show usage and exit"},
+	{OE::FILE_IN,    'i', "input",  "file",          "Input file (load recording)"},
+	{OE::FILE_OUT,   'o', "output", "file",          "Output file (replay stats)"},
+	{OE::CNT_LIVE,   'l', "live",   "cnt",           "Live input, buffer up to cnt frames"},
+	{OE::IVAL_START, 's', "start",  "ival",          "Start replay at the given recording time"},
+	{OE::IVAL_END,   'e', "end",    "ival",          "End replay at the given recording time"},
+	{OE::FILE_INDEX, 'I', "index",  "file",          "Frame index file for fast seeking"},
+	{OE::CMD,         0 , "",       "command,[...]", "The command to execute"},
 };
 
 /**
@@ -160,6 +170,20 @@ int main(int argc, char * argv[]) try {
 		case OE::FILE_OUT:
 			env["LOADPLAY_OUT"] = filename(getopt[1]);
 			break;
+		case OE::CNT_LIVE:
+			env["LOADPLAY_LIVE"] = getopt[1];
+			break;
+		case OE::IVAL_START:
+			env["LOADPLAY_START"] =
+			    std::to_string(ival(getopt[1]).count()).c_str();
+			break;
+		case OE::IVAL_END:
+			env["LOADPLAY_END"] =
+			    std::to_string(ival(getopt[1]).count()).c_str();
+			break;
+		case OE::FILE_INDEX:
+			env["LOADPLAY_INDEX"] = getopt[1];
+			break;
 		case OE::CMD:
 			env["LD_PRELOAD"] = "libloadplay.so";
 			assert(getopt.offset() < argc &&
@@ -184,6 +208,10 @@ int main(int argc, char * argv[]) try {
 			break;
 		case OE::FILE_IN:
 		case OE::FILE_OUT:
+		case OE::CNT_LIVE:
+		case OE::IVAL_START:
+		case OE::IVAL_END:
+		case OE::FILE_INDEX:
 			e.msg += "\n\n"s += getopt.show(1);
 			break;
 		case OE::CMD:
@@ -16,12 +16,18 @@
 
 #include "sys/io.hpp"
 #include "sys/sysctl.hpp"
+#include "sys/signal.hpp"
 
 #include <chrono>    /* std::chrono::steady_clock::now() */
 #include <thread>    /* std::this_thread::sleep_until() */
 #include <memory>    /* std::unique_ptr */
+#include <charconv>  /* std::to_chars() */
+#include <limits>    /* std::numeric_limits */
 
-#include <sys/resource.h>  /* CPUSTATES */
+#include <csignal>   /* SIGINT, SIGTERM, SIGUSR1 */
+
+#include <sys/resource.h>  /* CPUSTATES, getrusage() */
+#include <sys/stat.h>      /* fstat() */
 
 /**
  * File local scope.
@@ -36,11 +42,16 @@ using constants::FREQ;
 using constants::FREQ_LEVELS;
 using constants::FREQ_DRIVER;
 using constants::CP_TIMES;
+using constants::TEMPERATURE;
+using constants::TJMAX_SOURCES;
+using constants::TOPOLOGY;
+using constants::SUBSAMPLE_MAX;
 
 using types::ms;
 using types::coreid_t;
 using types::cptime_t;
 using types::mhz_t;
+using types::decikelvin_t;
 
 using errors::Exit;
 using errors::Exception;
@@ -48,9 +59,16 @@ using errors::fail;
 
 using utility::to_value;
 using utility::sprintf_safe;
+using utility::Sum;
+using utility::Min;
+using utility::Max;
+using utility::Formatter;
 using namespace std::literals::string_literals;
 
 using clas::ival;
+using clas::freq;
+using clas::count;
+using clas::formatfields;
 
 using sys::ctl::Sysctl;
 using sys::ctl::Once;
@@ -72,7 +90,12 @@ using version::flag_t;
 using namespace version::literals;
 
 /**
- * The set of supported features.
+ * Microsecond type for high-rate frame durations.
+ */
+using us = std::chrono::microseconds;
+
+/**
+ * The set of features that are always recorded.
  *
  * This value is stored in load recordings to allow loadplay to correctly
  * interpret the data.
@@ -81,6 +104,16 @@ constexpr flag_t const FEATURES{
 	1_FREQ_TRACKING
 };
 
+/**
+ * The recording time between two frame index checkpoints.
+ */
+constexpr us const INDEX_INTERVAL{1000000};
+
+/**
+ * The buffer size for output files.
+ */
+constexpr size_t const BUFFER_SIZE{65536};
+
 /**
  * The global state.
  */
@@ -89,6 +122,43 @@ struct {
 	ms duration{30000};   /**< Recording duration in ms. */
 	ms interval{25};      /**< Recording sample interval in ms. */
 
+	/**
+	 * The feature flags of the recording.
+	 */
+	flag_t features{FEATURES};
+
+	/**
+	 * Flight recorder mode, keep the last duration of frames in
+	 * a ring buffer.
+	 */
+	bool ring{false};
+
+	/**
+	 * Dump the ring buffer when all cores are saturated while
+	 * clocked below this frequency.
+	 */
+	mhz_t trigger{0};
+
+	/**
+	 * Sample core temperatures every temprate frames.
+	 */
+	size_t temprate{0};
+
+	/**
+	 * Sample the AC line state every aclinerate frames.
+	 */
+	size_t aclinerate{0};
+
+	/**
+	 * The last signal received, used for terminating.
+	 */
+	volatile sig_atomic_t signal{0};
+
+	/**
+	 * Set to request dumping the ring buffer.
+	 */
+	volatile sig_atomic_t dump{0};
+
 	/**
 	 * The output stream either io::fout (stdout) or a file.
 	 */
@@ -99,6 +169,22 @@ struct {
 	 */
 	char const * outfilename{nullptr};
 
+	/**
+	 * Set if the output is a pipe or FIFO, in that case every
+	 * frame is flushed immediately for live consumption.
+	 */
+	bool live{false};
+
+	/**
+	 * The frame index output file.
+	 */
+	ofile<io::link> findex{};
+
+	/**
+	 * The user provided frame index file name.
+	 */
+	char const * indexfilename{nullptr};
+
 	/**
 	 * The number of CPU cores/threads.
 	 */
@@ -113,8 +199,14 @@ enum class OE {
 	IVAL_DURATION,   /**< Set the duration of the recording */
 	IVAL_POLL,       /**< Set polling interval */
 	FILE_OUTPUT,     /**< Set output file */
+	FILE_INDEX,      /**< Set frame index output file */
 	FILE_PID,        /**< Set PID file */
 	FLAG_VERBOSE,    /**< Verbose output on stderr */
+	FLAG_HIGHRATE,   /**< Record frame durations in µs */
+	FLAG_RING,       /**< Flight recorder mode */
+	FREQ_TRIGGER,    /**< Set flight recorder dump trigger */
+	CNT_TEMPERATURE, /**< Record core temperatures */
+	CNT_ACLINE,      /**< Record AC line state */
 	OPT_UNKNOWN,     /**< Obligatory */
 	OPT_NOOPT,       /**< Obligatory */
 	OPT_DASH,        /**< Obligatory */
@@ -125,18 +217,24 @@ enum class OE {
 /**
  * The short usage string.
  */
-char const * const USAGE = "[-hv] [-d ival] [-p ival] [-o file]";
+char const * const USAGE = "[-hvHr] [-d ival] [-p ival] [-t freq] [-T cnt] [-a cnt] [-o file] [-I file]";
 
 /**
  * Definitions of command line parameters.
  */
 Parameter<OE> const PARAMETERS[]{
-	{OE::USAGE,         'h', "help",     "",     "Show usage and exit"},
-	{OE::FLAG_VERBOSE,  'v', "verbose",  "",     "Be verbose"},
-	{OE::IVAL_DURATION, 'd', "duration", "ival", "The duration of the recording"},
-	{OE::IVAL_POLL,     'p', "poll",     "ival", "The polling interval"},
-	{OE::FILE_OUTPUT,   'o', "output",   "file", "Output to file"},
-	{OE::FILE_PID,      'P', "pid",      "file", "Ignored"},
+	{OE::USAGE,           'h', "help",        "",     "Show usage and exit"},
+	{OE::FLAG_VERBOSE,    'v', "verbose",     "",     "Be verbose"},
+	{OE::FLAG_HIGHRATE,   'H', "high-rate",   "",     "Record frame durations in microseconds"},
+	{OE::FLAG_RING,       'r', "ring",        "",     "Flight recorder mode, keep the last duration in memory"},
+	{OE::IVAL_DURATION,   'd', "duration",    "ival", "The duration of the recording"},
+	{OE::IVAL_POLL,       'p', "poll",        "ival", "The polling interval"},
+	{OE::FREQ_TRIGGER,    't', "trigger",     "freq", "Dump when all cores are saturated below freq"},
+	{OE::CNT_TEMPERATURE, 'T', "temperature", "cnt",  "Record core temperatures every cnt frames"},
+	{OE::CNT_ACLINE,      'a', "acline",      "cnt",  "Record the AC line state every cnt frames"},
+	{OE::FILE_OUTPUT,     'o', "output",      "file", "Output to file"},
+	{OE::FILE_INDEX,      'I', "index",       "file", "Output a frame index to file"},
+	{OE::FILE_PID,        'P', "pid",         "file", "Ignored"},
 };
 
 /**
@@ -157,15 +255,51 @@ inline void verbose(MsgTs &&... msg) {
 
 /**
  * Set up output to the given file.
+ *
+ * In flight recorder mode the output file is opened for each dump,
+ * in that case the file name may contain a `%d` to insert the dump
+ * number.
+ *
+ * The frame index refers to byte offsets in the output file, so it
+ * requires a regular output file.
  */
 void init() {
+	if (g.indexfilename && (g.ring || !g.outfilename)) {
+		fail(Exit::ECLARG, 0,
+		     "a frame index requires an output file and cannot be used in flight recorder mode");
+	}
+	if (g.ring) {
+		if (g.outfilename) {
+			formatfields(g.outfilename, 'd');
+		}
+		verbose("flight recorder: %lld ms in %zu frames\n",
+		        static_cast<long long>(g.duration.count()),
+		        static_cast<size_t>(g.duration / g.interval) + 1);
+		return;
+	}
 	if (g.outfilename) {
 		static ofile<io::own> outfile{g.outfilename, "wb"};
 		if (!outfile) {
 			fail(Exit::EWOPEN, errno,
 			     "could not open file for writing: "s + g.outfilename);
 		}
-		g.fout = outfile;
+		g.fout = outfile.buffer(BUFFER_SIZE);
+	}
+	if (g.indexfilename) {
+		static ofile<io::own> indexfile{g.indexfilename, "wb"};
+		if (!indexfile) {
+			fail(Exit::EWOPEN, errno,
+			     "could not open file for writing: "s + g.indexfilename);
+		}
+		g.findex = indexfile.buffer(BUFFER_SIZE);
+	}
+
+	/* stream frames into pipes and FIFOs */
+	struct stat st{};
+	g.live = !fstat(fileno(g.fout.get()), &st) &&
+	         (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode));
+	if (g.live) {
+		verbose("live output, flushing every frame\n");
 	}
 }
 
@@ -186,6 +320,23 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::FLAG_VERBOSE:
 			g.verbose = true;
 			break;
+		case OE::FLAG_HIGHRATE:
+			g.features |= 1_DURATION_US;
+			break;
+		case OE::FLAG_RING:
+			g.ring = true;
+			break;
+		case OE::FREQ_TRIGGER:
+			g.trigger = freq(getopt[1]);
+			break;
+		case OE::CNT_TEMPERATURE:
+			g.temprate = count(getopt[1], SUBSAMPLE_MAX);
+			g.features |= 1_TEMP_TRACKING;
+			break;
+		case OE::CNT_ACLINE:
+			g.aclinerate = count(getopt[1], SUBSAMPLE_MAX);
+			g.features |= 1_ACLINE_TRACKING;
+			break;
 		case OE::IVAL_DURATION:
 			g.duration = ival(getopt[1]);
 			break;
@@ -195,6 +346,9 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::FILE_OUTPUT:
 			g.outfilename = getopt[1];
 			break;
+		case OE::FILE_INDEX:
+			g.indexfilename = getopt[1];
+			break;
 		case OE::FILE_PID:
 			break;
 		case OE::OPT_UNKNOWN:
@@ -211,12 +365,18 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::USAGE:
 			break;
 		case OE::FLAG_VERBOSE:
+		case OE::FLAG_HIGHRATE:
+		case OE::FLAG_RING:
 			e.msg += "\n\n";
 			e.msg += getopt.show(0);
 			break;
 		case OE::IVAL_DURATION:
 		case OE::IVAL_POLL:
+		case OE::FREQ_TRIGGER:
+		case OE::CNT_TEMPERATURE:
+		case OE::CNT_ACLINE:
 		case OE::FILE_OUTPUT:
+		case OE::FILE_INDEX:
 		case OE::FILE_PID:
 			e.msg += "\n\n";
 			e.msg += getopt.show(1);
@@ -237,31 +397,58 @@ void read_args(int const argc, char const * const argv[]) {
 
 /**
  * Print the sysctls
+ *
+ * @param fout
+ *	The file to print to
  */
-void print_sysctls() {
+void print_sysctls(ofile<io::link> fout) {
 	Sysctl hw_acpi_acline;
 	try {
 		hw_acpi_acline = {ACLINE};
 	} catch (sys::sc_error<sys::ctl::error>) {
 		verbose("cannot read %s\n", ACLINE);
 	}
-	g.fout.printf("%s=%ld\n"
+	fout.printf("%s=%ld\n"
 	              "hw.machine=%s\n"
 	              "hw.model=%s\n"
 	              "hw.ncpu=%d\n"
 	              "%s=%d\n",
-	              LOADREC_FEATURES, FEATURES,
+	              LOADREC_FEATURES, g.features,
 	              Sysctl{CTL_HW, HW_MACHINE}.get<char>().get(),
 	              Sysctl{CTL_HW, HW_MODEL}.get<char>().get(),
 	              g.ncpu,
 	              ACLINE, Once{1U, hw_acpi_acline});
 
+	/* the topology is multi-line XML, join it into a single line */
+	try {
+		auto const topology = Sysctl{TOPOLOGY}.get<char>();
+		for (auto pch = topology.get(); *pch; ++pch) {
+			if (*pch == '\n') { *pch = ' '; }
+		}
+		fout.printf("%s=%s\n", TOPOLOGY, topology.get());
+	} catch (sys::sc_error<sys::ctl::error>) {
+		verbose("cannot access sysctl: %s\n", TOPOLOGY);
+	}
+
 	for (coreid_t i = 0; i < g.ncpu; ++i) {
 		char mibname[40];
+		for (auto const mibbasename : {TEMPERATURE, TJMAX_SOURCES[0]}) {
+			if (!(g.features & 1_TEMP_TRACKING)) {
+				break;
+			}
+			sprintf_safe(mibname, mibbasename, i);
+			try {
+				Sysctl ctl{mibname};
+				fout.printf("%s=%d\n", mibname,
+				            Once{decikelvin_t{0}, ctl});
+			} catch (sys::sc_error<sys::ctl::error>) {
+				verbose("cannot access sysctl: %s\n", mibname);
+			}
+		}
 		sprintf_safe(mibname, FREQ, i);
 		try {
 			Sysctl ctl{mibname};
-			g.fout.printf("%s=%d\n", mibname, Once{0, ctl});
+			fout.printf("%s=%d\n", mibname, Once{0, ctl});
 		} catch (sys::sc_error<sys::ctl::error> e) {
 			verbose("cannot access sysctl: %s\n", mibname);
 			if (i == 0) {
@@ -274,7 +461,7 @@ void print_sysctls() {
 			sprintf_safe(mibname, mibbasename, i);
 			try {
 				Sysctl ctl{mibname};
-				g.fout.printf("%s=%s\n", mibname, ctl.get<char>().get());
+				fout.printf("%s=%s\n", mibname, ctl.get<char>().get());
 			} catch (sys::sc_error<sys::ctl::error>) {
 				verbose("cannot access sysctl: %s\n", mibname);
 			}
@@ -282,78 +469,694 @@ void print_sysctls() {
 	}
 }
 
+/**
+ * A preallocated character buffer to assemble a frame in.
+ *
+ * Values are formatted using std::to_chars(), which avoids the
+ * format string interpretation of printf() for every single value.
+ * The complete frame is written with a single call to the output file.
+ */
+class FrameBuffer {
+	private:
+	/**
+	 * The maximum number of characters required to print an
+	 * unsigned long and a separator.
+	 */
+	static constexpr size_t const DIGITS{
+	    std::numeric_limits<unsigned long>::digits10 + 2};
+
+	/**
+	 * The buffer.
+	 */
+	std::unique_ptr<char[]> const buf;
+
+	/**
+	 * The end of the buffer, reserves space for the newline.
+	 */
+	char * const end;
+
+	/**
+	 * The current write position.
+	 */
+	char * it;
+
+	public:
+	/**
+	 * Allocate a buffer for the given number of values.
+	 *
+	 * @param values
+	 *	The number of values in a frame
+	 */
+	FrameBuffer(size_t const values) :
+	    buf{new char[values * DIGITS + 1]},
+	    end{this->buf.get() + values * DIGITS}, it{this->buf.get()} {}
+
+	/**
+	 * Append a value to the frame.
+	 *
+	 * All values but the first are preceded by a space.
+	 *
+	 * @tparam T
+	 *	The integral value type
+	 * @param value
+	 *	The value to append
+	 * @return
+	 *	A self reference
+	 */
+	template <typename T>
+	FrameBuffer & operator <<(T const value) {
+		if (this->it != this->buf.get() && this->it != this->end) {
+			*this->it++ = ' ';
+		}
+		this->it = std::to_chars(this->it, this->end, value).ptr;
+		return *this;
+	}
+
+	/**
+	 * Terminate the frame with a newline and write it to the
+	 * given file.
+	 *
+	 * The buffer is reset for the next frame.
+	 *
+	 * @param fout
+	 *	The file to write to
+	 */
+	void commit(ofile<io::link> fout) {
+		*this->it++ = '\n';
+		fout.write(this->buf.get(), this->it - this->buf.get());
+		this->it = this->buf.get();
+	}
+};
+
+/**
+ * The load, clock frequency, temperature and AC line sources to record.
+ *
+ * Besides kern.cp_times every frame contains a set of state values,
+ * the clock frequency of each core, optionally followed by the
+ * temperature of each core and the AC line state. Temperatures and
+ * the AC line state are only sampled every g.temprate and
+ * g.aclinerate frames, the last sampled value is repeated in between.
+ */
+struct Sources {
+	/**
+	 * The kern.cp_times sysctl.
+	 */
+	Sysctl<0> const cp_times_ctl{CP_TIMES};
+
+	/**
+	 * The number of kern.cp_times columns.
+	 */
+	size_t const columns{cp_times_ctl.size() / sizeof(cptime_t)};
+
+	/**
+	 * The number of cores in kern.cp_times.
+	 */
+	coreid_t const cores = this->columns / CPUSTATES;
+
+	/**
+	 * The clock frequency source for each core.
+	 */
+	std::unique_ptr<SysctlSync<mhz_t>[]> const corefreqs{
+	    new SysctlSync<mhz_t>[this->cores]{}};
+
+	/**
+	 * The number of recorded core temperatures.
+	 */
+	coreid_t const temps = g.features & 1_TEMP_TRACKING ? this->cores : 0;
+
+	/**
+	 * The number of recorded AC line states.
+	 */
+	size_t const aclines = g.features & 1_ACLINE_TRACKING ? 1 : 0;
+
+	/**
+	 * The number of state values per frame.
+	 */
+	size_t const states{static_cast<size_t>(this->cores) + this->temps +
+	                    this->aclines};
+
+	/**
+	 * The temperature source for each core.
+	 */
+	std::unique_ptr<SysctlSync<decikelvin_t>[]> const coretemps{
+	    new SysctlSync<decikelvin_t>[this->temps]{}};
+
+	/**
+	 * The AC line state source.
+	 */
+	SysctlSync<unsigned> acline{};
+
+	/**
+	 * The last sampled temperatures and AC line state.
+	 */
+	std::unique_ptr<cptime_t[]> const sampled{
+	    new cptime_t[this->temps + this->aclines]{}};
+
+	/**
+	 * The number of frames sampled.
+	 */
+	size_t frame{0};
+
+	/**
+	 * Setup clock frequency, temperature and AC line sources.
+	 *
+	 * @throws sys::sc_error<sys::ctl::error>
+	 *	If kern.cp_times is not accessible
+	 */
+	Sources() {
+		for (coreid_t i = 0; i < this->cores; ++i) {
+			char mibname[40];
+			sprintf_safe(mibname, FREQ, i);
+			try {
+				this->corefreqs[i] = Sysctl{mibname};
+			} catch (sys::sc_error<sys::ctl::error> e) {
+				if (i == 0) {
+					fail(Exit::ENOFREQ, e,
+					     "at least the first CPU core must report its clock frequency");
+				}
+				/* Fall back to previous clock provider. */
+				this->corefreqs[i] = this->corefreqs[i - 1];
+			}
+		}
+		for (coreid_t i = 0; i < this->temps; ++i) {
+			char mibname[40];
+			sprintf_safe(mibname, TEMPERATURE, i);
+			try {
+				this->coretemps[i] = Sysctl{mibname};
+			} catch (sys::sc_error<sys::ctl::error> e) {
+				if (i == 0) {
+					fail(Exit::ESYSCTL, e,
+					     "at least the first CPU core must report its temperature");
+				}
+				/* Fall back to previous temperature provider. */
+				this->coretemps[i] = this->coretemps[i - 1];
+			}
+		}
+		if (this->aclines) try {
+			this->acline = Sysctl{ACLINE};
+		} catch (sys::sc_error<sys::ctl::error> e) {
+			fail(Exit::ESYSCTL, e, "cannot access sysctl: "s + ACLINE);
+		}
+	}
+
+	/**
+	 * Retrieve kern.cp_times.
+	 *
+	 * @param dst
+	 *	The buffer to write the columns to
+	 */
+	void cp_times(cptime_t * const dst) const {
+		this->cp_times_ctl.get(dst, sizeof(cptime_t) * this->columns);
+	}
+
+	/**
+	 * Retrieve the state values of a frame.
+	 *
+	 * The clock frequencies are retrieved every frame, temperatures
+	 * and the AC line state at their configured rates.
+	 *
+	 * @param dst
+	 *	The buffer to write the state values to
+	 */
+	void state(cptime_t * const dst) {
+		for (coreid_t i = 0; i < this->cores; ++i) {
+			dst[i] = this->corefreqs[i];
+		}
+		if (this->temps && this->frame % g.temprate == 0) {
+			for (coreid_t i = 0; i < this->temps; ++i) {
+				decikelvin_t const temp = this->coretemps[i];
+				this->sampled[i] = temp > 0 ? temp : 0;
+			}
+		}
+		if (this->aclines && this->frame % g.aclinerate == 0) {
+			this->sampled[this->temps] = this->acline;
+		}
+		for (size_t i = 0; i < this->temps + this->aclines; ++i) {
+			dst[this->cores + i] = this->sampled[i];
+		}
+		++this->frame;
+	}
+};
+
 /**
  * Report the load frames.
  *
- * This prints the time in ms since the last frame and the cp_times
- * growth as a space separated list.
+ * This prints the time in ms (or µs with the DURATION_US feature)
+ * since the last frame, the state values and the cp_times growth
+ * as a space separated list.
+ *
+ * If a frame index is requested, a checkpoint is written to the
+ * index every INDEX_INTERVAL of recording time. A checkpoint
+ * consists of the recording time in µs at the beginning of a frame,
+ * the byte offset of the frame in the output file and the absolute
+ * kern.cp_times values at the beginning of the frame.
+ *
+ * In verbose mode the CPU time consumed by the recording and the
+ * deviation of the sampling times from the sampling schedule are
+ * reported on completion.
  */
 void run() try {
+	Sources src{};
+	auto const columns = src.columns;
+	auto const states = src.states;
+
 	/*
 	 * Setup cptimes buffer for two samples.
 	 */
-	Sysctl const cp_times_ctl{CP_TIMES};
-
-	auto const columns = cp_times_ctl.size() / sizeof(cptime_t);
 	auto cp_times = std::unique_ptr<cptime_t[]>(
 	    new cptime_t[2 * columns]{});
 
 	/*
-	 * Setup clock frequency sources for each core.
+	 * Setup buffer for the clock frequencies, temperatures and
+	 * AC line state.
 	 */
-	coreid_t const cores = columns / CPUSTATES;
-	auto corefreqs = std::unique_ptr<SysctlSync<mhz_t>[]>(
-	    new SysctlSync<mhz_t>[cores]{});
+	auto state = std::unique_ptr<cptime_t[]>(new cptime_t[states]{});
 
-	for (coreid_t i = 0; i < cores; ++i) {
-		char mibname[40];
-		sprintf_safe(mibname, FREQ, i);
-		try {
-			corefreqs[i] = Sysctl{mibname};
-		} catch (sys::sc_error<sys::ctl::error> e) {
-			if (i == 0) {
-				fail(Exit::ENOFREQ, e,
-				     "at least the first CPU core must report its clock frequency");
-			}
-			/* Fall back to previous clock provider. */
-			corefreqs[i] = corefreqs[i - 1];
-		}
-	}
+	/*
+	 * Setup the frame buffer for the duration, state values
+	 * and cptimes.
+	 */
+	FrameBuffer frame{1 + states + columns};
+	bool const highrate = g.features & 1_DURATION_US;
+
+	/*
+	 * Setup the frame index checkpoint buffer for time, offset
+	 * and cptimes.
+	 */
+	FrameBuffer checkpoint{2 + columns};
+	us elapsed{0};
+	us nextCheckpoint{0};
 
 	/*
 	 * Record freq and cptimes.
 	 */
-	auto time = std::chrono::steady_clock::now();
+	auto const start = std::chrono::steady_clock::now();
+	auto time = start;
 	auto last = time;
+	auto sampled = time;
+	auto lastSampled = time;
 	auto const stop = time + g.duration;
 	size_t sample = 0;
+	/* sampling time deviation from the schedule */
+	Sum<us::rep> jitterSum{};
+	Min<us::rep> jitterMin{std::numeric_limits<us::rep>::max()};
+	Max<us::rep> jitterMax{0};
+	size_t samples = 0;
 	/* Takes a sample and prints it, avoids duplicating code
 	 * behind the loop. */
 	auto const takeAndPrintSample = [&]() {
-		cp_times_ctl.get(&cp_times[sample * columns],
-		                 sizeof(cptime_t) * columns);
-		g.fout.printf("%lld", std::chrono::duration_cast<ms>(time - last).count());
-		for (coreid_t i = 0; i < cores; ++i) {
-			g.fout.printf(" %u", static_cast<mhz_t>(corefreqs[i]));
+		src.cp_times(&cp_times[sample * columns]);
+		src.state(state.get());
+		sampled = std::chrono::steady_clock::now();
+		auto const jitter =
+		    std::chrono::duration_cast<us>(sampled - time).count();
+		jitterSum += jitter;
+		jitterMin = jitter;
+		jitterMax = jitter;
+		++samples;
+		/* the first frame has no duration */
+		if (samples == 1) {
+			lastSampled = sampled;
+		}
+		us duration{0};
+		if (highrate) {
+			/* the actual duration covered by the cptimes */
+			duration = std::chrono::duration_cast<us>(sampled - lastSampled);
+			frame << duration.count();
+		} else {
+			auto const scheduled =
+			    std::chrono::duration_cast<ms>(time - last);
+			frame << scheduled.count();
+			duration = scheduled;
+		}
+		auto const begin = elapsed;
+		elapsed += duration;
+		for (size_t i = 0; i < states; ++i) {
+			frame << state[i];
 		}
 		for (size_t i = 0; i < columns; ++i) {
-			g.fout.printf(" %lu", cp_times[sample * columns + i] -
-			                      cp_times[((sample + 1) % 2) * columns + i]);
+			frame << (cp_times[sample * columns + i] -
+			          cp_times[((sample + 1) % 2) * columns + i]);
+		}
+		/* checkpoint the state at the beginning of the frame,
+		 * the first frame only initialises the state */
+		if (g.findex && samples > 1 && begin >= nextCheckpoint) {
+			checkpoint << begin.count() << std::ftell(g.fout.get());
+			for (size_t i = 0; i < columns; ++i) {
+				checkpoint << cp_times[((sample + 1) % 2) * columns + i];
+			}
+			checkpoint.commit(g.findex);
+			nextCheckpoint = begin + INDEX_INTERVAL;
+		}
+		frame.commit(g.fout);
+		if (g.live) {
+			g.fout.flush();
 		}
-		g.fout.putc('\n');
 	};
+	takeAndPrintSample();
+	lastSampled = sampled;
 	while (time < stop) {
-		takeAndPrintSample();
 		sample = (sample + 1) % 2;
 		last = time;
 		std::this_thread::sleep_until(time += g.interval);
+		takeAndPrintSample();
+		lastSampled = sampled;
 	}
-	takeAndPrintSample();
 	g.fout.flush();
+	g.findex.flush();
+
+	/*
+	 * Report recording overhead.
+	 */
+	if (!g.verbose) {
+		return;
+	}
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	auto const cpu =
+	    std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+	    us{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+	auto const wall = std::chrono::steady_clock::now() - start;
+	verbose("recorded %zu frames in %lld ms\n"
+	        "\tCPU time:        %lld us (%.3f%%)\n"
+	        "\tsampling jitter: min %lld us, max %lld us, mean %lld us\n",
+	        samples, std::chrono::duration_cast<ms>(wall).count(),
+	        static_cast<long long>(cpu.count()),
+	        100. * cpu.count() /
+	        std::chrono::duration_cast<us>(wall).count(),
+	        static_cast<long long>(jitterMin),
+	        static_cast<long long>(jitterMax),
+	        static_cast<long long>(jitterSum / samples));
 } catch (sys::sc_error<sys::ctl::error> e) {
 	fail(Exit::ESYSCTL, e, "failed to access sysctl: "s + CP_TIMES);
 }
 
+/**
+ * Sets g.signal, terminating the flight recorder.
+ *
+ * @param signal
+ *	The signal number received
+ */
+void signal_recv(int signal) {
+	g.signal = signal;
+}
+
+/**
+ * Sets g.dump, requesting a flight recorder dump.
+ */
+void dump_recv(int) {
+	g.dump = 1;
+}
+
+/**
+ * A fixed size ring buffer of frames for the flight recorder.
+ *
+ * Each slot contains the sampling time, the state values (clock
+ * frequencies, temperatures and AC line state) and the kern.cp_times
+ * columns. The sampling time and the columns are stored as the
+ * growth since the previous frame, which fits into 32 bits, so a
+ * slot takes half the space of the raw values. The absolute values
+ * of the oldest and the latest frame are kept separately.
+ */
+class Ring {
+	private:
+	/**
+	 * The slot value type.
+	 */
+	using value_t = uint32_t;
+
+	/**
+	 * The load and state sources.
+	 */
+	Sources & src;
+
+	/**
+	 * The number of values in a slot.
+	 */
+	size_t const stride{1 + this->src.states + this->src.columns};
+
+	/**
+	 * The number of slots.
+	 */
+	size_t const slots;
+
+	/**
+	 * The slots buffer.
+	 */
+	std::unique_ptr<value_t[]> const buf{
+	    new value_t[this->slots * this->stride]{}};
+
+	/**
+	 * The absolute sampling time and columns of the oldest frame.
+	 */
+	std::unique_ptr<cptime_t[]> const oldest{new cptime_t[this->stride]{}};
+
+	/**
+	 * The absolute values of the latest frame.
+	 */
+	std::unique_ptr<cptime_t[]> const latest{new cptime_t[this->stride]{}};
+
+	/**
+	 * The buffer to sample a frame into.
+	 */
+	std::unique_ptr<cptime_t[]> const current{new cptime_t[this->stride]{}};
+
+	/**
+	 * The next slot to write.
+	 */
+	size_t head{0};
+
+	/**
+	 * The number of slots containing frames.
+	 */
+	size_t fill{0};
+
+	/**
+	 * Access a slot relative to the oldest frame.
+	 *
+	 * @param i
+	 *	The frame index
+	 * @return
+	 *	A pointer to the first value of the slot
+	 */
+	value_t const * operator [](size_t const i) const {
+		auto const first = this->head + this->slots - this->fill;
+		return &this->buf[(first + i) % this->slots * this->stride];
+	}
+
+	/**
+	 * Returns whether a slot value is stored as growth.
+	 *
+	 * @param i
+	 *	The value index within the slot
+	 * @return
+	 *	Whether the value is the sampling time or a column
+	 */
+	bool growth(size_t const i) const {
+		return i == 0 || i >= 1 + this->src.states;
+	}
+
+	public:
+	/**
+	 * Construct a ring buffer.
+	 *
+	 * @param src
+	 *	The load and state sources
+	 * @param slots
+	 *	The number of frames to keep
+	 */
+	Ring(Sources & src, size_t const slots) :
+	    src{src}, slots{slots > 1 ? slots : 2} {}
+
+	/**
+	 * Sample a frame into the next slot, overwriting the oldest
+	 * frame if the ring is full.
+	 *
+	 * @param time
+	 *	The sampling time in µs
+	 */
+	void sample(cptime_t const time) {
+		/* the second oldest frame becomes the oldest */
+		if (this->fill == this->slots) {
+			auto const next = (*this)[1];
+			for (size_t i = 0; i < this->stride; ++i) {
+				this->oldest[i] += growth(i) ? next[i] : 0;
+			}
+		}
+
+		auto const prev = this->latest.get();
+		auto const now = this->current.get();
+		auto const slot = &this->buf[this->head * this->stride];
+		now[0] = time;
+		this->src.state(now + 1);
+		this->src.cp_times(now + 1 + this->src.states);
+		for (size_t i = 0; i < this->stride; ++i) {
+			if (!growth(i)) {
+				slot[i] = now[i];
+				continue;
+			}
+			/* saturate, e.g. after a suspend */
+			slot[i] = std::min<cptime_t>(
+			    this->fill ? now[i] - prev[i] : 0,
+			    std::numeric_limits<value_t>::max());
+			prev[i] = now[i];
+			if (!this->fill) {
+				this->oldest[i] = now[i];
+			}
+		}
+		this->head = (this->head + 1) % this->slots;
+		this->fill += this->fill < this->slots;
+	}
+
+	/**
+	 * Check whether all cores were saturated during the last
+	 * frame, while clocked below the given frequency.
+	 *
+	 * @param freq
+	 *	The clock frequency
+	 * @return
+	 *	Whether all cores were busy during the latest frame
+	 */
+	bool saturated(mhz_t const freq) const {
+		if (this->fill < 2) {
+			return false;
+		}
+		auto const cur = (*this)[this->fill - 1];
+		for (coreid_t i = 0; i < this->src.cores; ++i) {
+			if (cur[1 + i] >= value_t(freq)) {
+				return false;
+			}
+			auto const offset = 1 + this->src.states + i * CPUSTATES;
+			cptime_t all = 0;
+			for (size_t state = 0; state < CPUSTATES; ++state) {
+				all += cur[offset + state];
+			}
+			if (!all || cur[offset + CP_IDLE]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Print all frames in the ring as a load record.
+	 *
+	 * The first frame contains the absolute kern.cp_times values,
+	 * all following frames contain the growth.
+	 *
+	 * @param fout
+	 *	The file to print to
+	 * @param frame
+	 *	The buffer to assemble frames in
+	 * @return
+	 *	The number of frames printed
+	 */
+	size_t print(ofile<io::link> fout, FrameBuffer & frame) const {
+		bool const highrate = g.features & 1_DURATION_US;
+		cptime_t time = this->oldest[0];
+		for (size_t n = 0; n < this->fill; ++n) {
+			auto const cur = (*this)[n];
+			if (!n) {
+				frame << 0;
+			} else if (highrate) {
+				frame << cur[0];
+			} else {
+				/* round the timestamps to avoid drift */
+				frame << ((time + cur[0]) / 1000 - time / 1000);
+			}
+			time += n ? cur[0] : 0;
+			for (size_t i = 1; i < 1 + this->src.states; ++i) {
+				frame << cur[i];
+			}
+			for (size_t i = 1 + this->src.states; i < this->stride; ++i) {
+				frame << (n ? cur[i] : this->oldest[i]);
+			}
+			frame.commit(fout);
+		}
+		return this->fill;
+	}
+};
+
+/**
+ * Dump the flight recorder ring buffer as a load record.
+ *
+ * @param ring
+ *	The ring buffer to dump
+ * @param frame
+ *	The buffer to assemble frames in
+ * @param count
+ *	The number of the dump, inserted into the output file name
+ */
+void dump(Ring const & ring, FrameBuffer & frame, int const count) {
+	ofile<io::own> outfile{};
+	auto fout = g.fout;
+	std::string name{"stdout"};
+	if (g.outfilename) {
+		name = Formatter<4096>{g.outfilename}(count);
+		outfile = ofile<io::own>{name.c_str(), "wb"};
+		if (!outfile) {
+			/* keep recording */
+			io::ferr.printf("loadrec: could not open file for writing: %s\n",
+			                name.c_str());
+			return;
+		}
+		fout = outfile.buffer(BUFFER_SIZE);
+	}
+	print_sysctls(fout);
+	auto const frames = ring.print(fout, frame);
+	fout.flush();
+	verbose("dumped %zu frames to %s\n", frames, name.c_str());
+}
+
+/**
+ * Run the flight recorder.
+ *
+ * Frames are recorded into a ring buffer until SIGINT or SIGTERM
+ * is received. The ring buffer is dumped on SIGUSR1 or when the
+ * dump trigger condition occurs.
+ */
+void run_ring() try {
+	Sources src{};
+	Ring ring{src, static_cast<size_t>(g.duration / g.interval) + 1};
+	FrameBuffer frame{1 + src.states + src.columns};
+
+	/* setup signal handlers */
+	sys::sig::Signal sigint{SIGINT, signal_recv};
+	sys::sig::Signal sigterm{SIGTERM, signal_recv};
+	sys::sig::Signal sigusr1{SIGUSR1, dump_recv};
+
+	int dumps = 0;
+	bool triggered = false;
+	auto const start = std::chrono::steady_clock::now();
+	for (auto time = start; !g.signal;
+	     std::this_thread::sleep_until(time += g.interval)) {
+		ring.sample(std::chrono::duration_cast<us>(
+		    std::chrono::steady_clock::now() - start).count());
+
+		/* only trigger on entering the saturated state */
+		if (g.trigger) {
+			auto const saturated = ring.saturated(g.trigger);
+			if (saturated && !triggered) {
+				verbose("all cores saturated below %d MHz\n",
+				        g.trigger);
+				g.dump = 1;
+			}
+			triggered = saturated;
+		}
+
+		if (g.dump) {
+			g.dump = 0;
+			dump(ring, frame, dumps++);
+		}
+	}
+	verbose("signal %d received, exiting ...\n", g.signal);
+} catch (sys::sc_error<sys::ctl::error> e) {
+	fail(Exit::ESYSCTL, e, "failed to access sysctl: "s + CP_TIMES);
+} catch (sys::sc_error<sys::sig::error> e) {
+	fail(Exit::ESIGNAL, e,
+	     "failed to register signal handler: "s + e.c_str());
+}
+
 } /* namespace */
 
 
@@ -369,8 +1172,12 @@ void run() try {
 int main(int argc, char * argv[]) try {
 	read_args(argc, argv);
 	init();
-	print_sysctls();
-	run();
+	if (g.ring) {
+		run_ring();
+	} else {
+		print_sysctls(g.fout);
+		run();
+	}
 	return to_value(Exit::OK);
 } catch (Exception & e) {
 	if (e.msg != "") {
@@ -0,0 +1,449 @@
+/**
+ * Implements loadtrain, a trainer for powerd++ policy tables.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+#include "Policy.hpp"
+
+#include "types.hpp"
+#include "errors.hpp"
+#include "utility.hpp"
+#include "clas.hpp"
+
+#include "sys/io.hpp"
+
+#include <vector>    /* std::vector */
+#include <algorithm> /* std::min(), std::max() */
+
+#include <cstdlib>   /* strtod(), free() */
+#include <cstring>   /* strncmp(), memcpy() */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using types::cptime_t;
+using types::mhz_t;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+namespace io = sys::io;
+
+using utility::to_value;
+using clas::samples;
+using namespace utility::literals;
+
+using namespace std::literals::string_literals;
+
+/**
+ * The number of candidate clock frequencies per cell.
+ *
+ * The candidates divide [0, policy::UNIT] evenly.
+ */
+size_t const STEPS{33};
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,              /**< Print help */
+	FILE_OUT,           /**< Set output file instead of stdout */
+	CNT_SAMPLES,        /**< Set the number of load samples */
+	WEIGHT_AC,          /**< Set the latency weight on AC power */
+	WEIGHT_BATT,        /**< Set the latency weight on battery power */
+	WEIGHT_UNKNOWN,     /**< Set the latency weight for unknown power */
+	FILE_IN,            /**< An input file */
+	OPT_NOOPT = FILE_IN, /**< Obligatory */
+	OPT_UNKNOWN,        /**< Obligatory */
+	OPT_DASH,           /**< Obligatory */
+	OPT_LDASH,          /**< Obligatory */
+	OPT_DONE            /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-h] [-o file] [-s cnt] [-a weight] [-b weight] [-n weight] [file ...]";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,          'h', "help",    "",           "Show usage and exit"},
+	{OE::FILE_OUT,       'o', "output",  "file",       "Output file (policy table)"},
+	{OE::CNT_SAMPLES,    's', "samples", "cnt",        "The number of load samples powerd++ uses"},
+	{OE::WEIGHT_AC,      'a', "ac",      "weight",     "Latency weight on AC power"},
+	{OE::WEIGHT_BATT,    'b', "batt",    "weight",     "Latency weight on battery power"},
+	{OE::WEIGHT_UNKNOWN, 'n', "unknown", "weight",     "Latency weight if the power source is unknown"},
+	{OE::FILE_IN,         0 , "",        "file,[...]", "Input files (replay stats)"},
+};
+
+/**
+ * The accumulated costs of all candidate clock frequencies for a
+ * combination of load and trend bins.
+ */
+struct Costs {
+	/**
+	 * The energy spent by each candidate.
+	 */
+	double energy[STEPS]{};
+
+	/**
+	 * The load each candidate could not serve.
+	 */
+	double latency[STEPS]{};
+
+	/**
+	 * The number of samples.
+	 */
+	size_t count{0};
+};
+
+/**
+ * The global state.
+ */
+struct Global {
+	/**
+	 * The output file name, stdout if unset.
+	 */
+	char const * outfilename{nullptr};
+
+	/**
+	 * The number of load samples.
+	 */
+	size_t samples{4};
+
+	/**
+	 * The latency weight per AC line state in the range [0, 1024].
+	 *
+	 * The remainder of 1024 is the energy weight.
+	 */
+	cptime_t weights[policy::AC_BINS]{512, 768, 640};
+
+	/**
+	 * The costs per trend and load bin.
+	 */
+	Costs costs[policy::TREND_BINS][policy::LOAD_BINS];
+
+	/**
+	 * The number of training samples.
+	 */
+	size_t count{0};
+} g; /**< The global state. */
+
+/**
+ * Performs very rudimentary file name argument checks.
+ *
+ * - Fail on empty path
+ * - Return nullptr on '-'
+ *
+ * @param path
+ *	The file path to check
+ * @return
+ *	The given path or nullptr if the given path is '-'
+ */
+char const * filename(char const * const path) {
+	if (!path || !path[0]) {
+		fail(Exit::EFILE, 0, "empty or missing string for filename");
+	}
+	if ("-"s == path) {
+		return nullptr;
+	}
+	return path;
+}
+
+/**
+ * Parse a latency weight.
+ *
+ * Weights are plain fractions, unlike loads they do not accept
+ * a percentage.
+ *
+ * @param str
+ *	A fraction in the range [0.0, 1.0]
+ * @return
+ *	The weight in the range [0, 1024]
+ * @throws errors::Exception{Exit::ECLARG}
+ *	If the value is not a number
+ * @throws errors::Exception{Exit::EOUTOFRANGE}
+ *	If the value is out of range
+ */
+cptime_t weight(char const * const str) {
+	if (!str || !*str) {
+		fail(Exit::ECLARG, 0, "latency weight value missing");
+	}
+	char * end{nullptr};
+	auto const value = std::strtod(str, &end);
+	if (*end) {
+		fail(Exit::ECLARG, 0, "latency weight must be a number: "s + str);
+	}
+	if (!(value >= 0. && value <= 1.)) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "latency weights must be in the range [0.0, 1.0]");
+	}
+	return cptime_t(value * 1024 + .5);
+}
+
+/**
+ * Accumulate the costs of a replay.
+ *
+ * The input is the output of loadplay. The recorded load of the
+ * busiest core in each frame is the demand, the recorded clock
+ * frequencies determine the maximum clock frequency.
+ *
+ * The features of every frame are computed like powerd++ does
+ * from the last samples frames, the decision is rated by the
+ * demand of the following frame.
+ *
+ * @param fin
+ *	The input file
+ * @param name
+ *	The input file name for error messages
+ * @throws errors::Exception{Exit::EFILE}
+ *	If the input is not loadplay output
+ */
+void train(io::file<io::link, io::read> fin, char const * const name) {
+	char * buf{nullptr};
+	size_t capacity{0};
+
+	/* parse the header */
+	if (fin.getline(buf, capacity) < 0 ||
+	    0 != std::strncmp(buf, "time[s]", 7)) {
+		free(buf);
+		fail(Exit::EFILE, 0, "%s: loadplay output expected"_fmt(name));
+	}
+	size_t cols{0};
+	for (char const * pos = buf; *pos; ++pos) {
+		cols += (*pos != ' ' && *pos != '\n') &&
+		        (pos == buf || pos[-1] == ' ');
+	}
+	if (cols < 5 || (cols - 1) % 4) {
+		free(buf);
+		fail(Exit::EFILE, 0,
+		     "%s: unexpected number of columns: %zu"_fmt(name, cols));
+	}
+	auto const ncpu = (cols - 1) / 4;
+
+	/* collect the demand of every frame */
+	std::vector<mhz_t> demand;
+	mhz_t ref{0};
+	while (fin.getline(buf, capacity) > 0) {
+		char * pos = buf;
+		std::strtod(pos, &pos);
+		mhz_t load{0};
+		for (size_t i = 0; i < ncpu; ++i) {
+			auto const rec_freq = std::strtod(pos, &pos);
+			auto const rec_load = std::strtod(pos, &pos);
+			std::strtod(pos, &pos);
+			std::strtod(pos, &pos);
+			ref = std::max(ref, mhz_t(rec_freq + .5));
+			load = std::max(load, mhz_t(rec_load + .5));
+		}
+		demand.push_back(load);
+	}
+	free(buf);
+	if (!ref || demand.size() <= g.samples) {
+		return;
+	}
+
+	/* accumulate costs */
+	mhz_t loadsum{0};
+	for (size_t i = 0; i < g.samples; ++i) {
+		loadsum += demand[i];
+	}
+	for (size_t t = g.samples - 1; t + 1 < demand.size(); ++t) {
+		if (t >= g.samples) {
+			loadsum += demand[t];
+			loadsum -= demand[t - g.samples];
+		}
+		mhz_t const mean = loadsum / g.samples;
+		auto & costs =
+		    g.costs[policy::trend_bin(policy::TREND_BINS, demand[t],
+		                              mean, ref)]
+		           [policy::load_bin(policy::LOAD_BINS, mean, ref)];
+		double const next = double(demand[t + 1]) / ref;
+		for (size_t k = 0; k < STEPS; ++k) {
+			double const freq = double(k) / (STEPS - 1);
+			/* busy time at the given clock times its power */
+			costs.energy[k] += std::min(next, freq) * freq * freq;
+			costs.latency[k] += std::max(next - freq, 0.);
+		}
+		++costs.count;
+		++g.count;
+	}
+}
+
+/**
+ * Write the policy table.
+ *
+ * For each cell the candidate with the least weighted sum of
+ * energy and latency costs is selected. The AC line state bins
+ * only differ by their weights. Replays contain no temperatures,
+ * so the table has a single temperature bin.
+ *
+ * @throws errors::Exception{Exit::EWOPEN}
+ *	If the output file cannot be written
+ */
+void write() {
+	policy::Header head{};
+	std::memcpy(head.magic, policy::MAGIC, sizeof(head.magic));
+	head.version = policy::VERSION;
+	head.samples = g.samples;
+	head.load_bins = policy::LOAD_BINS;
+	head.trend_bins = policy::TREND_BINS;
+	head.temp_bins = 1;
+	head.ac_bins = policy::AC_BINS;
+
+	std::vector<uint16_t> cells(policy::cells(head), policy::UNSET);
+	for (unsigned ac = 0; ac < head.ac_bins; ++ac) {
+		double const alpha = g.weights[ac] / 1024.;
+		double const beta = 1. - alpha;
+		for (unsigned temp = 0; temp < head.temp_bins; ++temp) {
+			for (unsigned trend = 0; trend < head.trend_bins; ++trend) {
+				for (unsigned load = 0; load < head.load_bins; ++load) {
+					auto const & costs = g.costs[trend][load];
+					if (!costs.count) { continue; }
+					size_t best{0};
+					for (size_t k = 1; k < STEPS; ++k) {
+						if (beta * costs.energy[k] +
+						    alpha * costs.latency[k] <
+						    beta * costs.energy[best] +
+						    alpha * costs.latency[best]) {
+							best = k;
+						}
+					}
+					cells[policy::index(head, ac, temp,
+					                    trend, load)] =
+					    best * policy::UNIT / (STEPS - 1);
+				}
+			}
+		}
+	}
+
+	io::file<io::own, io::write> outfile{};
+	if (g.outfilename) {
+		outfile = io::file<io::own, io::write>{g.outfilename, "wb"};
+		if (!outfile) {
+			fail(Exit::EWOPEN, errno,
+			     "could not open file for writing: "s +
+			     g.outfilename);
+		}
+	}
+	io::file<io::link, io::write> fout{g.outfilename ? outfile.get()
+	                                                 : io::fout.get()};
+	fout.write(head);
+	fout.write(cells.data(), cells.size());
+	fout.flush();
+	if (fout.error()) {
+		fail(Exit::EWOPEN, errno, "could not write the policy table");
+	}
+}
+
+} /* namespace */
+
+/**
+ * Parse command line arguments, train and write a policy table.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	std::vector<char const *> infiles;
+	bool done{false};
+	try {
+		while (!done) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FILE_OUT:
+			g.outfilename = filename(getopt[1]);
+			break;
+		case OE::CNT_SAMPLES:
+			g.samples = samples(getopt[1]);
+			break;
+		case OE::WEIGHT_AC:
+			g.weights[1] = weight(getopt[1]);
+			break;
+		case OE::WEIGHT_BATT:
+			g.weights[0] = weight(getopt[1]);
+			break;
+		case OE::WEIGHT_UNKNOWN:
+			g.weights[2] = weight(getopt[1]);
+			break;
+		case OE::FILE_IN:
+			infiles.push_back(filename(getopt[0]));
+			break;
+		case OE::OPT_DASH:
+			infiles.push_back(nullptr);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+			break;
+		case OE::OPT_DONE:
+			done = true;
+			break;
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FILE_OUT:
+		case OE::CNT_SAMPLES:
+		case OE::WEIGHT_AC:
+		case OE::WEIGHT_BATT:
+		case OE::WEIGHT_UNKNOWN:
+			e.msg += "\n\n"s += getopt.show(1);
+			break;
+		case OE::FILE_IN:
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+		case OE::OPT_DONE:
+			e.msg += "\n\n"s += getopt.show(0);
+			break;
+		}
+		throw;
+	}
+
+	if (infiles.empty()) {
+		infiles.push_back(nullptr);
+	}
+	for (auto const name : infiles) {
+		if (!name) {
+			train(io::fin, "stdin");
+			continue;
+		}
+		io::file<io::own, io::read> infile{name, "r"};
+		if (!infile) {
+			fail(Exit::EFILE, errno, "cannot open %s"_fmt(name));
+		}
+		train(io::file<io::link, io::read>{infile.get()}, name);
+	}
+	if (!g.count) {
+		fail(Exit::EFILE, 0, "the input contains no training samples");
+	}
+	write();
+	return to_value(Exit::OK);
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("loadtrain: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("loadtrain: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
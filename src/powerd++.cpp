@@ -6,22 +6,32 @@
 
 #include "Options.hpp"
 #include "Cycle.hpp"
+#include "Topology.hpp"
+#include "Policy.hpp"
+#include "Periodicity.hpp"
+#include "Journal.hpp"
+#include "hint.hpp"
 
 #include "types.hpp"
 #include "constants.hpp"
 #include "errors.hpp"
 #include "clas.hpp"
 #include "utility.hpp"
+#include "version.hpp"
 
 #include "sys/sysctl.hpp"
 #include "sys/pidfile.hpp"
 #include "sys/signal.hpp"
+#include "sys/event.hpp"
 #include "sys/io.hpp"
 
 #include <locale>    /* std::tolower() */
 #include <memory>    /* std::unique_ptr */
 #include <algorithm> /* std::min(), std::max() */
 #include <limits>    /* std::numeric_limits */
+#include <vector>    /* std::vector */
+#include <chrono>    /* std::chrono::steady_clock */
+#include <string>    /* std::string */
 
 #include <cstdlib>   /* strtol() */
 #include <cstdint>   /* uint64_t */
@@ -50,6 +60,7 @@ using clas::load;
 using clas::freq;
 using clas::ival;
 using clas::samples;
+using clas::count;
 using clas::temperature;
 using clas::celsius;
 using clas::range;
@@ -72,6 +83,8 @@ using constants::FREQ_DRIVER;
 using constants::FREQ_DRIVER_BLACKLIST;
 using constants::TEMPERATURE;
 using constants::TJMAX_SOURCES;
+using constants::TOPOLOGY;
+using constants::EPP;
 
 using constants::FREQ_DEFAULT_MAX;
 using constants::FREQ_DEFAULT_MIN;
@@ -80,6 +93,18 @@ using constants::POWERD_PIDFILE;
 using constants::ADP;
 using constants::HADP;
 using constants::HITEMP_OFFSET;
+using constants::EPP_HYSTERESIS;
+using constants::HINT_SOCKET;
+using constants::HINT_RATE;
+using constants::HINT_RATE_MAX;
+using constants::HINT_DURATION_MAX;
+using constants::JOURNAL_SIZE;
+using constants::JOURNAL_SIZE_MAX;
+using constants::VERIFY_MAX;
+
+using version::LOADREC_FEATURES;
+using version::flag_t;
+using namespace version::literals;
 
 using sys::ctl::Sysctl;
 using sys::ctl::Once;
@@ -100,6 +125,149 @@ enum class AcLineState : unsigned int {
 	LENGTH   /**< Enum length */
 };
 
+/**
+ * The core classes of hybrid CPUs.
+ */
+enum class CoreClass : unsigned int {
+	PERFORMANCE, /**< Performance cores (P-cores) */
+	EFFICIENCY,  /**< Efficiency cores (E-cores) */
+	LENGTH       /**< Enum length */
+};
+
+/**
+ * The clock control backends.
+ */
+enum class Backend : unsigned int {
+	FREQ, /**< Set the clock frequency through dev.cpu.%d.freq */
+	EPP   /**< Set the energy/performance preference of HW P-states */
+};
+
+/**
+ * Applies the clock frequency decisions for a core group.
+ *
+ * The frequency backend sets the requested clock frequency.
+ *
+ * The energy/performance preference (EPP) backend is used with
+ * hardware P-states, which select the clock frequency autonomously.
+ * The requested frequency is mapped from the frequency range of the
+ * group onto the EPP range, where 0 prefers performance and 100
+ * prefers efficiency. Changes smaller than EPP_HYSTERESIS are not
+ * applied, unless they reach the end of the range.
+ */
+class Actuator {
+	private:
+	/**
+	 * The backend.
+	 */
+	Backend type{Backend::FREQ};
+
+	/**
+	 * The dev.cpu.%d.freq or EPP sysctl.
+	 */
+	SysctlSync<int> ctl{{}};
+
+	/**
+	 * The last value written, -1 if none.
+	 */
+	int value{-1};
+
+	public:
+	/**
+	 * Default constructor.
+	 */
+	Actuator() = default;
+
+	/**
+	 * Construct from a backend and sysctl.
+	 *
+	 * @param type
+	 *	The backend type
+	 * @param ctl
+	 *	The sysctl to write
+	 */
+	Actuator(Backend const type, Sysctl<0> const & ctl) :
+	    type{type}, ctl{ctl} {}
+
+	/**
+	 * Returns the backend type.
+	 *
+	 * @return
+	 *	The backend type
+	 */
+	Backend backend() const {
+		return this->type;
+	}
+
+	/**
+	 * Returns the last value written.
+	 *
+	 * @return
+	 *	The clock frequency or EPP value, -1 if none
+	 */
+	int get() const {
+		return this->value;
+	}
+
+	/**
+	 * Read the sysctl.
+	 *
+	 * @return
+	 *	The current clock frequency or EPP value
+	 * @throws sys::sc_error<sys::ctl::error>
+	 *	If reading the sysctl fails
+	 */
+	int read() const {
+		return this->ctl;
+	}
+
+	/**
+	 * Write the sysctl, bypassing the EPP hysteresis.
+	 *
+	 * @param value
+	 *	The clock frequency or EPP value
+	 * @throws sys::sc_error<sys::ctl::error>
+	 *	If writing the sysctl fails
+	 */
+	void write(int const value) {
+		this->ctl = value;
+	}
+
+	/**
+	 * Apply a clock frequency.
+	 *
+	 * @param current
+	 *	The current clock frequency
+	 * @param freq
+	 *	The requested clock frequency
+	 * @param min,max
+	 *	The clock frequency range
+	 * @throws sys::sc_error<sys::ctl::error>
+	 *	If writing the sysctl fails
+	 */
+	void operator ()(mhz_t const current, mhz_t const freq,
+	                 mhz_t const min, mhz_t const max) {
+		switch (this->type) {
+		case Backend::FREQ:
+			if (current != freq) {
+				this->ctl = this->value = freq;
+			}
+			return;
+		case Backend::EPP: {
+			int const epp = max <= min ? 0 :
+			    100 * (max - std::clamp(freq, min, max)) / (max - min);
+			if (epp == this->value) {
+				return;
+			}
+			if (this->value < 0 || epp == 0 || epp == 100 ||
+			    std::abs(epp - this->value) >= EPP_HYSTERESIS) {
+				this->ctl = this->value = epp;
+			}
+			return;
+		}
+		}
+	}
+};
+
 /**
  * Contains the management information for a group of cores with
  * a common clock frequency.
@@ -110,11 +278,32 @@ struct CoreGroup {
 	 */
 	SysctlSync<mhz_t> freq{{}};
 
+	/**
+	 * Applies clock frequency changes.
+	 */
+	Actuator actuator;
+
 	/**
 	 * The number of the core owning dev.cpu.%d.freq.
 	 */
 	coreid_t corei{0};
 
+	/**
+	 * The package the group belongs to.
+	 *
+	 * Packages are derived from kern.sched.topology_spec, without
+	 * a topology all groups belong to package 0.
+	 */
+	coreid_t package{0};
+
+	/**
+	 * The class of the cores in the group.
+	 *
+	 * All groups are performance cores unless init() detects a
+	 * hybrid CPU.
+	 */
+	CoreClass coreclass{CoreClass::PERFORMANCE};
+
 	/**
 	 * The dev.cpu.%d.freq value for the current load sample.
 	 *
@@ -122,6 +311,45 @@ struct CoreGroup {
 	 */
 	mhz_t sample_freq{0};
 
+	/**
+	 * The dev.cpu.%d.freq_levels clock frequencies, empty unless
+	 * the driver offers more than one level.
+	 */
+	std::vector<mhz_t> levels;
+
+	/**
+	 * The clock frequency at the start of the current load sample,
+	 * 0 if unknown.
+	 *
+	 * This is updated by update_freq().
+	 */
+	mhz_t start_freq{0};
+
+	/**
+	 * The clock frequency in effect during the current load sample.
+	 *
+	 * This is updated by update_loads().
+	 */
+	mhz_t load_freq{0};
+
+	/**
+	 * The clock frequency last written or read, 0 if unknown.
+	 *
+	 * Used instead of reading dev.cpu.%d.freq while trusted.
+	 */
+	mhz_t cached{0};
+
+	/**
+	 * Set while the cached clock frequency can be trusted.
+	 */
+	bool trusted{false};
+
+	/**
+	 * Set if the clock frequency was written since it was last
+	 * read.
+	 */
+	bool written{false};
+
 	/**
 	 * The minimum group clock rate.
 	 *
@@ -136,6 +364,34 @@ struct CoreGroup {
 	 */
 	Min<mhz_t> max{FREQ_DEFAULT_MAX};
 
+	/**
+	 * The turbo clock rate, 0 if the group has no turbo level.
+	 *
+	 * The est and cpufreq drivers report turbo as a level of the
+	 * nominal maximum plus 1 MHz.
+	 */
+	mhz_t turbo{0};
+
+	/**
+	 * The nominal maximum clock rate, i.e. the level below turbo.
+	 */
+	mhz_t nominal{0};
+
+	/**
+	 * Set while turbo is permitted.
+	 */
+	bool turbo_on{false};
+
+	/**
+	 * The time turbo has been demanded continuously.
+	 */
+	std::chrono::microseconds turbo_demand{0};
+
+	/**
+	 * The remaining time before turbo may be permitted again.
+	 */
+	std::chrono::microseconds turbo_cooldown{0};
+
 	/**
 	 * The maximum load reported by all cores in the group.
 	 *
@@ -143,6 +399,24 @@ struct CoreGroup {
 	 */
 	Max<mhz_t> load{0};
 
+	/**
+	 * Set if a core in the group reported ticks during the current
+	 * cycle.
+	 *
+	 * This is updated by update_loads().
+	 */
+	bool sampled{false};
+
+	/**
+	 * The number of load samples, determined by the core class.
+	 */
+	size_t samples{0};
+
+	/**
+	 * The current sample.
+	 */
+	size_t sample{0};
+
 	/**
 	 * A ring buffer of maximum load samples for this core group.
 	 *
@@ -160,6 +434,33 @@ struct CoreGroup {
 	 */
 	mhz_t loadsum{0};
 
+	/**
+	 * Detects periodic loads, inactive unless requested.
+	 *
+	 * This is updated by update_loads().
+	 */
+	periodicity::Detector periodic;
+
+	/**
+	 * The minimum clock frequency requested by a boost hint.
+	 */
+	mhz_t boost{0};
+
+	/**
+	 * The priority of the boost hint.
+	 */
+	unsigned int boost_priority{0};
+
+	/**
+	 * The end of the boost hint.
+	 */
+	std::chrono::steady_clock::time_point boost_until{};
+
+	/**
+	 * The clock frequency selected by the last update_freq().
+	 */
+	mhz_t decision{0};
+
 	/**
 	 * Critical core temperature in dK.
 	 */
@@ -228,9 +529,14 @@ struct Global {
 	ms interval{500};
 
 	/**
-	 * The current sample.
+	 * The actual duration of the last cycle.
 	 */
-	size_t sample{0};
+	std::chrono::microseconds elapsed{0};
+
+	/**
+	 * The timer slack, wakeups are rounded up to multiples of it.
+	 */
+	ms slack{0};
 
 	/**
 	 * The number of CPU cores or threads.
@@ -279,6 +585,149 @@ struct Global {
 		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, HADP, 0, "unknown"}
 	};
 
+	/**
+	 * Per core class settings.
+	 *
+	 * These are applied in addition to the AC line state settings.
+	 */
+	struct ClassSet {
+		/**
+		 * Lowest frequency to set in MHz.
+		 */
+		mhz_t freq_min;
+
+		/**
+		 * Highest frequency to set in MHz.
+		 */
+		mhz_t freq_max;
+
+		/**
+		 * Target load times [1, 1024].
+		 *
+		 * The value 0 indicates the AC line state target load
+		 * should be used.
+		 */
+		cptime_t target_load;
+
+		/**
+		 * The number of load samples to take.
+		 *
+		 * The value 0 indicates the global number of samples
+		 * should be used.
+		 */
+		size_t samples;
+
+		/**
+		 * The string representation of this class.
+		 */
+		char const * const name;
+	};
+
+	/**
+	 * The core classes.
+	 */
+	ClassSet classes[2]{
+		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, 0, 0, "performance"},
+		{FREQ_DEFAULT_MIN, FREQ_DEFAULT_MAX, 0, 0, "efficiency"}
+	};
+
+	/**
+	 * Keep efficiency cores at their lowest clock until the
+	 * performance cores are saturated.
+	 */
+	bool defer_efficiency{false};
+
+	/**
+	 * Prefer the energy/performance preference of hardware
+	 * P-states over setting the clock frequency.
+	 */
+	bool epp{false};
+
+	/**
+	 * The boost hint socket path, no socket is created if unset.
+	 */
+	char const * hint_socket{nullptr};
+
+	/**
+	 * The number of boost hints accepted per second.
+	 */
+	size_t hint_rate{HINT_RATE};
+
+	/**
+	 * The time the boost hint rate limit is charged up to.
+	 *
+	 * Every accepted hint moves this ahead by 1/hint_rate s,
+	 * a hint is dropped if it is already 1 s ahead.
+	 */
+	std::chrono::steady_clock::time_point hint_time{};
+
+	/**
+	 * The maximum period of periodic loads in samples, periodic
+	 * load detection is off if 0.
+	 */
+	size_t period{0};
+
+	/**
+	 * The number of cycles between reading back the clock
+	 * frequency, it is read every cycle if 0.
+	 */
+	size_t verify{0};
+
+	/**
+	 * Set to gate the turbo clock level.
+	 */
+	bool turbo{false};
+
+	/**
+	 * The time turbo must be demanded before it is permitted.
+	 */
+	ms turbo_hold{0};
+
+	/**
+	 * The time after leaving turbo before it may be permitted again.
+	 */
+	ms turbo_cooldown{0};
+
+	/**
+	 * The number of update_loads() calls.
+	 */
+	size_t cycles{0};
+
+	/**
+	 * The policy table file, the load feedback loop is used if unset.
+	 */
+	char const * policy_file{nullptr};
+
+	/**
+	 * The trained policy table.
+	 */
+	policy::Table policy;
+
+	/**
+	 * The journal file, no journal is written if unset.
+	 */
+	char const * journal_file{nullptr};
+
+	/**
+	 * The journal size limit in MiB.
+	 */
+	size_t journal_size{JOURNAL_SIZE};
+
+	/**
+	 * The journal writer.
+	 */
+	std::unique_ptr<journal::Writer> journal;
+
+	/**
+	 * The kern.cp_times values of the previous journal record.
+	 */
+	std::unique_ptr<cptime_t[][CPUSTATES]> journal_cp_times;
+
+	/**
+	 * The command line, recorded in the journal.
+	 */
+	std::string args;
+
 	/**
 	 * The hw.acpi.acline ctl.
 	 */
@@ -345,6 +794,19 @@ struct Global {
 	 */
 	std::unique_ptr<Core[]> cores{new Core[this->ncpu]};
 
+	/**
+	 * The order in which cores are visited.
+	 *
+	 * Cores sharing a cache are adjacent, so the per core data
+	 * of a core group is accessed in sequence.
+	 */
+	std::unique_ptr<coreid_t[]> order{new coreid_t[this->ncpu]{}};
+
+	/**
+	 * The number of CPU packages.
+	 */
+	coreid_t npackages{1};
+
 	/**
 	 * The number of frequency controlling core groups.
 	 */
@@ -354,6 +816,9 @@ struct Global {
 	 * This buffer is to be allocated with the number of core
 	 * groups. A core group is created by init() for each core
 	 * that has a dev.cpu.%d.freq handle.
+	 *
+	 * The groups are laid out in the order of their controlling
+	 * cores in the order buffer.
 	 */
 	std::unique_ptr<CoreGroup[]> groups{nullptr};
 
@@ -371,6 +836,9 @@ struct Global {
 static_assert(countof(g.acstates) == to_value(AcLineState::LENGTH),
               "There must be a configuration tuple for each state");
 
+static_assert(countof(g.classes) == to_value(CoreClass::LENGTH),
+              "There must be a configuration tuple for each core class");
+
 /**
  * Outputs the given printf style message on stderr if g.verbose is set.
  *
@@ -414,49 +882,138 @@ void init() {
 		verbose("cannot read %s\n", ACLINE);
 	}
 
+	/*
+	 * Get the scheduler topology, without it cores are assumed to
+	 * be numbered contiguously within a clock domain.
+	 */
+	topology::Topology topo;
+	try {
+		topo = topology::Topology{Sysctl{TOPOLOGY}.get<char>().get()};
+	} catch (sys::sc_error<sys::ctl::error>) {
+		verbose("cannot access sysctl: %s\n", TOPOLOGY);
+	}
+	for (coreid_t core = 0; core < g.ncpu; ++core) {
+		g.order[core] = core;
+	}
+	if (topo) {
+		/* only use a topology that covers every core once */
+		std::vector<bool> seen(g.ncpu);
+		coreid_t count{0};
+		for (auto const core : topo.order()) {
+			if (core >= 0 && core < g.ncpu && !seen[core]) {
+				seen[core] = true;
+				g.order[count++] = core;
+			}
+		}
+		if (count != g.ncpu) {
+			verbose("incomplete CPU topology: %s\n", TOPOLOGY);
+			topo = {};
+			for (coreid_t core = 0; core < g.ncpu; ++core) {
+				g.order[core] = core;
+			}
+		}
+	}
+
 	/*
 	 * Count the number of controlling cores and set up the core
 	 * group buffer.
 	 */
+	std::vector<bool> controlling(g.ncpu);
 	for (coreid_t core = 0; core < g.ncpu; ++core) {
 		/* get the frequency handler */
 		char name[40];
 		sprintf_safe(name, FREQ, core);
 		try {
 			Sysctl{name};
+			controlling[core] = true;
 			++g.ngroups;
 		} catch (sys::sc_error<sys::ctl::error> e) {
+			if (e != ENOENT) {
+				verbose("cannot access sysctl: %s\n", name);
+				sysctl_fail(e);
+			}
 		}
 	}
+	if (!g.ngroups || (!topo && !controlling[0])) {
+		char name[40];
+		sprintf_safe(name, FREQ, 0);
+		fail(Exit::ENOFREQ, ENOENT, "cannot access "s + name + ", at least the first CPU core must support frequency updates");
+	}
 	g.groups = std::unique_ptr<CoreGroup[]>{new CoreGroup[g.ngroups]{}};
 
 	/*
-	 * Get the frequency controlling core for each core.
-	 * Basically acts as if the kernel supported local frequency changes.
+	 * Set up the groups in the order of their controlling cores.
 	 */
-	coreid_t groupi = -1;
-	for (coreid_t core = 0; core < g.ncpu; ++core) {
+	for (coreid_t i = 0, groupi = 0; i < g.ncpu; ++i) {
+		auto const core = g.order[i];
+		if (!controlling[core]) { continue; }
 		/* get the frequency handler and setup loads buffers */
 		char name[40];
 		sprintf_safe(name, FREQ, core);
+		auto & group = g.groups[groupi++];
 		try {
 			Sysctl const ctl{name};
-			auto & group = g.groups[++groupi];
 			group.freq = {ctl};
-			group.corei = core;
-			/* create loads buffer */
-			group.loads = std::unique_ptr<mhz_t[]>{new mhz_t[g.samples]{}};
+			group.actuator = {Backend::FREQ, ctl};
 		} catch (sys::sc_error<sys::ctl::error> e) {
-			if (e == ENOENT) {
-				if (0 > groupi) {
-					fail(Exit::ENOFREQ, e, "cannot access "s + name + ", at least the first CPU core must support frequency updates");
+			verbose("cannot access sysctl: %s\n", name);
+			sysctl_fail(e);
+		}
+		group.corei = core;
+		g.cores[core].group = &group;
+	}
+
+	/*
+	 * Get the frequency controlling core for each remaining core.
+	 *
+	 * That is the controlling core sharing the smallest topology
+	 * group, preferring the closest preceding core. Without a
+	 * topology it is the closest preceding controlling core.
+	 */
+	for (coreid_t core = 0; core < g.ncpu; ++core) {
+		auto & group = g.cores[core].group;
+		if (group) { continue; }
+		auto const path = topo.path(core);
+		for (auto it = path.rbegin(); !group && it != path.rend(); ++it) {
+			Max<coreid_t> before{-1};
+			Min<coreid_t> after{g.ncpu};
+			for (auto const member : (*it)->cpus) {
+				if (member < 0 || member >= g.ncpu ||
+				    !controlling[member]) {
+					continue;
 				}
-			} else {
-				verbose("cannot access sysctl: %s\n", name);
-				sysctl_fail(e);
+				if (member < core) {
+					before = member;
+				} else {
+					after = member;
+				}
+			}
+			if (before >= 0) {
+				group = g.cores[before].group;
+			} else if (after < g.ncpu) {
+				group = g.cores[after].group;
+			}
+		}
+		if (!group) {
+			/* core 0 is controlling without a topology */
+			assert(core > 0 && g.cores[core - 1].group);
+			group = g.cores[core - 1].group;
+		}
+	}
+
+	/*
+	 * Assign core groups to packages.
+	 */
+	auto const packages = topo.packages();
+	g.npackages = std::max<coreid_t>(packages.size(), 1);
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto & group = g.groups[i];
+		for (coreid_t pkg = 0; pkg < coreid_t(packages.size()); ++pkg) {
+			if (packages[pkg]->contains(group.corei)) {
+				group.package = pkg;
+				break;
 			}
 		}
-		g.cores[core].group = &g.groups[groupi];
 	}
 
 	/* set user frequency boundaries */
@@ -476,6 +1033,15 @@ void init() {
 			     (state.name, state.freq_min, state.freq_max));
 		}
 	}
+	for (auto const & coreclass : g.classes) {
+		if (coreclass.freq_min >= coreclass.freq_max) {
+			fail(Exit::EOUTOFRANGE, 0,
+			     "frequency limits 'min < max' violation:\n"
+			     "\t%s cores [%d MHz, %d MHz]"_fmt
+			     (coreclass.name, coreclass.freq_min,
+			      coreclass.freq_max));
+		}
+	}
 
 	/* setup temperature throttling */
 	if (g.temp_throttling) {
@@ -552,11 +1118,9 @@ void init() {
 	}
 
 	/* set per group settings */
-	CoreGroup * group = nullptr;
-	for (coreid_t i = 0; i < g.ncpu; ++i) {
-		auto & core = g.cores[i];
-		if (core.group == group) { continue; }
-		group = core.group;
+	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
+		auto & group = g.groups[groupi];
+		auto const i = group.corei;
 		char name[40];
 
 		/* set per group min/max frequency boundaries */
@@ -568,11 +1132,20 @@ void init() {
 			 * and vice versa */
 			Max<mhz_t> max{FREQ_DEFAULT_MIN};
 			Min<mhz_t> min{FREQ_DEFAULT_MAX};
+			/* the two greatest levels to detect turbo */
+			mhz_t top[2]{};
 			for (auto pch = levels.get(); *pch; ++pch) {
 				mhz_t freq = strtol(pch, &pch, 10);
 				if (pch[0] != '/') { break; }
 				max = freq;
 				min = freq;
+				group.levels.push_back(freq);
+				if (freq > top[0]) {
+					top[1] = top[0];
+					top[0] = freq;
+				} else if (freq > top[1]) {
+					top[1] = freq;
+				}
 				strtol(++pch, &pch, 10);
 				/* no idea what that value means */
 				if (pch[0] != ' ') { break; }
@@ -580,33 +1153,133 @@ void init() {
 			/* there is only one level with hwpstate */
 			if (min == max) {
 				min = FREQ_DEFAULT_MIN;
+				group.levels.clear();
 			}
 			assert(min < max &&
 			       "minimum must be less than maximum");
-			group->min = min;
-			group->max = max;
+			group.min = min;
+			group.max = max;
+			/* turbo is the nominal maximum + 1 MHz */
+			if (top[1] && top[0] == top[1] + 1) {
+				group.turbo = top[0];
+				group.nominal = top[1];
+			}
 		} catch (sys::sc_error<sys::ctl::error>) {
 			verbose("cannot access sysctl: %s\n", name);
 		}
 
 		/* check freq_drivers  */
+		std::unique_ptr<char[]> driver{nullptr};
 		sprintf_safe(name, FREQ_DRIVER, i);
 		try {
 			Sysctl const ctl{name};
-			auto driver = ctl.get<char>();
+			auto value = ctl.get<char>();
 			for (auto const prefix : FREQ_DRIVER_BLACKLIST) {
-				if (0 != std::strncmp(driver.get(), prefix,
+				if (0 == std::strncmp(value.get(), prefix,
 				                      std::strlen(prefix))) {
-					continue;
+					driver = std::move(value);
+					break;
 				}
-				fail(Exit::EDRIVER, 0,
-				     "frequency control driver not supported: %s"_fmt
-				     (driver.get()));
 			}
 		} catch (sys::sc_error<sys::ctl::error>) {
 			/* no driver is fine */
 			verbose("cannot access sysctl: %s\n", name);
 		}
+
+		/* use the energy/performance preference if requested
+		 * or necessary */
+		if (g.epp || driver) {
+			sprintf_safe(name, EPP, i);
+			try {
+				group.actuator = {Backend::EPP, Sysctl{name}};
+			} catch (sys::sc_error<sys::ctl::error>) {
+				verbose("cannot access sysctl: %s\n", name);
+			}
+		}
+		if (driver && group.actuator.backend() != Backend::EPP) {
+			fail(Exit::EDRIVER, 0,
+			     "frequency control driver not supported: %s"_fmt
+			     (driver.get()));
+		}
+	}
+
+	/*
+	 * Detect the core classes of hybrid CPUs.
+	 *
+	 * Groups with a clearly lower maximum clock are efficiency
+	 * cores. If the clock limits do not tell them apart, groups
+	 * without thread siblings on a CPU that has them are.
+	 */
+	Max<mhz_t> top{FREQ_DEFAULT_MIN};
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		if (g.groups[i].max < FREQ_DEFAULT_MAX) {
+			top = g.groups[i].max;
+		}
+	}
+	coreid_t efficiency{0};
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto & group = g.groups[i];
+		/* less than 7/8 of the highest clock */
+		if (group.max < FREQ_DEFAULT_MAX && group.max * 8 < top * 7) {
+			group.coreclass = CoreClass::EFFICIENCY;
+			++efficiency;
+		}
+	}
+	if (!efficiency && topo) {
+		std::vector<bool> threaded(g.ngroups);
+		coreid_t count{0};
+		for (coreid_t i = 0; i < g.ngroups; ++i) {
+			for (auto const node : topo.path(g.groups[i].corei)) {
+				threaded[i] = threaded[i] ||
+				              (node->flags & topology::THREAD);
+			}
+			count += threaded[i];
+		}
+		for (coreid_t i = 0; 0 < count && count < g.ngroups &&
+		                     i < g.ngroups; ++i) {
+			if (!threaded[i]) {
+				g.groups[i].coreclass = CoreClass::EFFICIENCY;
+			}
+		}
+	}
+
+	/* create loads buffers */
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto & group = g.groups[i];
+		auto const & coreclass = g.classes[to_value(group.coreclass)];
+		group.samples = coreclass.samples ? coreclass.samples : g.samples;
+		group.loads = std::unique_ptr<mhz_t[]>{
+			new mhz_t[group.samples]{}};
+		if (g.period) {
+			group.periodic = periodicity::Detector{g.period};
+		}
+	}
+
+	/* load the policy table */
+	if (g.policy_file) {
+		io::file<io::own, io::mmap> file{g.policy_file, "rb"};
+		if (!file) {
+			fail(Exit::EPOLICY, errno,
+			     "cannot open policy table %s"_fmt(g.policy_file));
+		}
+		g.policy = policy::Table{file.map()};
+		if (!g.policy) {
+			fail(Exit::EPOLICY, 0,
+			     "not a valid policy table: %s"_fmt(g.policy_file));
+		}
+		for (coreid_t i = 0; i < g.ngroups; ++i) {
+			auto const & group = g.groups[i];
+			if (group.max >= FREQ_DEFAULT_MAX) {
+				fail(Exit::EPOLICY, 0,
+				     "the policy table requires the clock frequency limits of cpu.%d"_fmt
+				     (group.corei));
+			}
+			if (group.samples != g.policy.header().samples) {
+				verbose("policy table trained for %u load samples, core group %d uses %zu\n",
+				        g.policy.header().samples, i,
+				        group.samples);
+			}
+		}
 	}
 
 	/* MIB for kern.cp_times */
@@ -633,6 +1306,64 @@ void init() {
 	}
 }
 
+/**
+ * Returns the clock frequency level a request resolves to.
+ *
+ * Like the cpufreq driver this selects the nearest level.
+ *
+ * @param group
+ *	The core group
+ * @param freq
+ *	The requested clock frequency
+ * @return
+ *	The clock frequency level, 0 if the resulting clock frequency
+ *	is not known
+ */
+mhz_t level(CoreGroup const & group, mhz_t const freq) {
+	/* the EPP backend does not control the clock */
+	if (group.actuator.backend() != Backend::FREQ) {
+		return 0;
+	}
+	mhz_t result{0};
+	auto diff = std::numeric_limits<mhz_t>::max();
+	for (auto const lvl : group.levels) {
+		auto const lvldiff = lvl > freq ? lvl - freq : freq - lvl;
+		if (lvldiff < diff) {
+			diff = lvldiff;
+			result = lvl;
+		}
+	}
+	return result;
+}
+
+/**
+ * Apply a clock frequency to a core group.
+ *
+ * The clock frequency level the request resolves to is cached for
+ * update_loads(). The cache is not trusted if the write fails or
+ * the resulting clock frequency is not known.
+ *
+ * @param group
+ *	The core group to clock
+ * @param freq
+ *	The requested clock frequency
+ * @param min,max
+ *	The clock frequency range
+ * @throws sys::sc_error<sys::ctl::error>
+ *	If writing the sysctl fails
+ */
+void apply(CoreGroup & group, mhz_t const freq, mhz_t const min,
+           mhz_t const max) {
+	auto const trusted = group.trusted;
+	group.trusted = false;
+	group.actuator(group.sample_freq, freq, min, max);
+	if (freq != group.sample_freq) {
+		group.cached = level(group, freq);
+		group.written = true;
+	}
+	group.trusted = trusted && group.cached;
+}
+
 /**
  * Updates the cp_times ring buffer and computes the load average for
  * each core.
@@ -662,14 +1393,38 @@ void update_loads() {
 	}
 
 	assert(g.groups);
+	bool const verify = !g.verify || !(g.cycles++ % g.verify);
 	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
 		/* reset controlling core data */
 		auto & group = g.groups[groupi];
-		group.sample_freq = group.freq;
+		if (verify || !group.trusted) {
+			mhz_t const freq = group.freq;
+			if (group.trusted && !group.written &&
+			    freq != group.cached) {
+				verbose("cpu.%d.freq changed externally: %d MHz -> %d MHz\n",
+				        group.corei, group.cached, freq);
+			}
+			group.cached = freq;
+			group.written = false;
+			/* the EPP backend does not control the clock */
+			group.trusted = g.verify &&
+			                group.actuator.backend() == Backend::FREQ;
+		}
+		group.sample_freq = group.cached;
+		/*
+		 * The clock changed at an unknown time during the
+		 * sample, e.g. due to a boost hint or throttling by
+		 * the driver, assume the middle of the sample.
+		 */
+		auto const start = group.start_freq;
+		group.load_freq = start && start != group.sample_freq
+		                  ? (start + group.sample_freq) / 2
+		                  : group.sample_freq;
 		Temperature && (group.temp = Max<decikelvin_t>{0});
 	}
 
-	for (coreid_t corei = 0; corei < g.ncpu; ++corei) {
+	for (coreid_t i = 0; i < g.ncpu; ++i) {
+		auto const corei = g.order[i];
 		auto & core = g.cores[corei];
 		assert(core.group);
 		auto & group = *core.group;
@@ -688,11 +1443,12 @@ void update_loads() {
 			cptime_t const idle = idle_new - core.idle;
 			core.idle = idle_new;
 
-			/* update current sample */
-			mhz_t const freq = group.sample_freq;
+			/* update current sample, in delivered clock cycles */
+			mhz_t const freq = group.load_freq;
 			if (all) {
 				/* measurement succeeded */
 				group.load = freq - (freq * idle) / all;
+				group.sampled = true;
 			} else {
 				/*
 				 * just hope another core in the group
@@ -713,19 +1469,43 @@ void update_loads() {
 		}
 	}
 
+	/*
+	 * Weight the sample with the share of the polling interval it
+	 * covers. With catchup::skip the cycle after an overrun ends
+	 * early to return to the rhythm and only contributes a
+	 * fraction of its load. Samples covering less than a quarter
+	 * of the interval are too coarse and discarded.
+	 */
+	uint64_t const span =
+	    std::chrono::microseconds{g.interval}.count();
+	uint64_t const weight = std::min<uint64_t>(g.elapsed.count(), span);
 	for (coreid_t groupi = 0; Load && groupi < g.ngroups; ++groupi) {
 		auto & group = g.groups[groupi];
+		if (!group.sampled || 4 * weight < span) {
+			group.load = Max<mhz_t>{0};
+			group.sampled = false;
+			continue;
+		}
+		mhz_t const newest =
+		    group.loads[(group.sample + group.samples - 1) %
+		                group.samples];
 		/* subtract oldest sample */
-		group.loadsum -= group.loads[g.sample];
+		group.loadsum -= group.loads[group.sample];
 		/* update current sample */
-		group.loads[g.sample] = group.load;
+		group.loads[group.sample] =
+		    (group.load * weight + newest * (span - weight)) / span;
 		/* add current sample */
-		group.loadsum += group.loads[g.sample];
+		group.loadsum += group.loads[group.sample];
+		/* track periodic loads */
+		if (group.periodic) {
+			group.periodic(group.loads[group.sample]);
+		}
 		/* reset current group load for next cycle */
 		group.load = Max<mhz_t>{0};
+		group.sampled = false;
+		/* next sample */
+		group.sample = (group.sample + 1) % group.samples;
 	}
-
-	Load && (g.sample = (g.sample + 1) % g.samples);
 }
 
 /**
@@ -733,6 +1513,50 @@ void update_loads() {
  */
 template <> void update_loads<0, 0>() {}
 
+/**
+ * Gate the turbo clock level of a core group.
+ *
+ * Turbo is permitted after it was demanded for the turbo hold time.
+ * It is revoked once it is no longer demanded or the group reaches
+ * the high temperature range, and not permitted again before the
+ * turbo cooldown time has passed.
+ *
+ * @tparam Temperature
+ *	Set for temperature based throttling
+ * @param group
+ *	The core group
+ * @param wantfreq
+ *	The clock frequency demanded by the load
+ * @param max
+ *	The maximum clock frequency
+ * @return
+ *	The demanded clock frequency, limited to the nominal maximum
+ *	unless turbo is permitted
+ */
+template <bool Temperature>
+mhz_t update_turbo(CoreGroup & group, mhz_t const wantfreq,
+                   mhz_t const max) {
+	if (!g.turbo || !group.turbo || max < group.turbo) {
+		return wantfreq;
+	}
+	bool const demand = wantfreq > group.nominal &&
+	                    !(Temperature && group.temp > group.temp_high);
+	group.turbo_cooldown -= std::min(group.turbo_cooldown, g.elapsed);
+	if (!demand) {
+		if (group.turbo_on) {
+			group.turbo_on = false;
+			group.turbo_cooldown = g.turbo_cooldown;
+		}
+		group.turbo_demand = {};
+	} else if (!group.turbo_on) {
+		group.turbo_demand += g.elapsed;
+		group.turbo_on = group.turbo_demand >= g.turbo_hold &&
+		                 group.turbo_cooldown.count() == 0;
+	}
+	return group.turbo_on ? wantfreq
+	                      : std::min(wantfreq, group.nominal);
+}
+
 /**
  * Update the CPU clocks depending on the AC line state and targets.
  *
@@ -747,20 +1571,72 @@ template <> void update_loads<0, 0>() {}
  */
 template <bool Foreground, bool Temperature, bool Fixed>
 void update_freq(Global::ACSet const & acstate) {
-	update_loads<(!Fixed || Foreground), Temperature>();
+	/* the journal records loads in fixed frequency mode */
+	if (!Fixed || Foreground || g.journal) {
+		update_loads<1, Temperature>();
+	} else {
+		update_loads<0, Temperature>();
+	}
 
 	assert(g.groups);
-	for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
-		auto & group = g.groups[groupi];
+	/*
+	 * Visit performance core groups first, so efficiency cores
+	 * can be deferred until the performance cores are saturated.
+	 */
+	bool saturated{true};
+	auto const now = g.hint_socket ? std::chrono::steady_clock::now()
+	                               : std::chrono::steady_clock::time_point{};
+	unsigned const acline = &acstate - g.acstates;
+	for (coreid_t i = 0; i < 2 * g.ngroups; ++i) {
+		auto & group = g.groups[i % g.ngroups];
+		auto const coreclass = i < g.ngroups ? CoreClass::PERFORMANCE
+		                                     : CoreClass::EFFICIENCY;
+		if (group.coreclass != coreclass) { continue; }
+		auto const & classet = g.classes[to_value(coreclass)];
+		auto const target_load = classet.target_load
+		                         ? classet.target_load
+		                         : acstate.target_load;
 
 		/* determine target frequency */
-		auto const max = std::min<mhz_t>(group.max, acstate.freq_max);
-		auto const min = std::max<mhz_t>(group.min, acstate.freq_min);
+		auto const max = std::min<mhz_t>({group.max, acstate.freq_max,
+		                                  classet.freq_max});
+		auto const min = std::max<mhz_t>({group.min, acstate.freq_min,
+		                                  classet.freq_min});
+		/* boost hints raise the minimum */
+		auto const floor = group.boost_until > now
+		                   ? std::min(std::max(min, group.boost), max)
+		                   : min;
 		mhz_t wantfreq{0};
 		if (!Fixed) {
 			/* adaptive frequency mode */
-			wantfreq = group.loadsum / g.samples *
-			           1024 / acstate.target_load;
+			mhz_t load = group.loadsum / group.samples;
+			/* serve the peaks of periodic loads */
+			if (group.periodic && group.periodic.period()) {
+				load = group.periodic.predict();
+			}
+			wantfreq = load * 1024 / target_load;
+			/* trained policy */
+			if (g.policy) {
+				auto const & head = g.policy.header();
+				mhz_t const mean = group.loadsum / group.samples;
+				mhz_t const newest =
+				    group.loads[(group.sample + group.samples - 1) %
+				                group.samples];
+				auto const cell = g.policy(
+				    acline,
+				    Temperature ? policy::temp_bin(head.temp_bins,
+				                                   group.temp,
+				                                   group.temp_high,
+				                                   group.temp_crit)
+				                : 0,
+				    policy::trend_bin(head.trend_bins, newest,
+				                      mean, group.max),
+				    policy::load_bin(head.load_bins, mean,
+				                     group.max));
+				if (cell != policy::UNSET) {
+					wantfreq = group.max * cell / policy::UNIT;
+				}
+			}
 		} else {
 			/* fixed frequency mode */
 			/*
@@ -771,7 +1647,15 @@ void update_freq(Global::ACSet const & acstate) {
 			wantfreq = acstate.target_freq;
 		}
 		Min<mhz_t> newfreq{max};
-		newfreq = std::max(min, wantfreq);
+		newfreq = std::max(floor, Fixed ? wantfreq
+		                                : update_turbo<Temperature>(
+		                                      group, wantfreq, max));
+		/* keep efficiency cores low */
+		if (coreclass == CoreClass::PERFORMANCE) {
+			saturated = saturated && wantfreq >= max;
+		} else if (g.defer_efficiency && !saturated) {
+			newfreq = floor;
+		}
 		/* apply temperature throttling */
 		if (Temperature) {
 			if (group.temp >= group.temp_crit) {
@@ -784,26 +1668,52 @@ void update_freq(Global::ACSet const & acstate) {
 			}
 		}
 		/* update CPU frequency */
-		if (group.sample_freq != newfreq) {
-			group.freq = newfreq;
-		}
+		group.decision = newfreq;
+		apply(group, newfreq, min, max);
+		/* the clock frequency of the next load sample, if known */
+		group.start_freq = group.actuator.backend() == Backend::FREQ
+		                   ? group.cached : 0;
 		/* foreground output */
 		if (Foreground && Temperature) {
 			io::fout.printf("power: %7s, load: %4d MHz, %3d C, cpu.%d.freq: %4d MHz, wanted: %4d MHz\n",
 			                acstate.name,
-			                (group.loadsum / g.samples),
+			                (group.loadsum / group.samples),
 			                celsius(group.temp), group.corei,
 			                group.sample_freq, wantfreq);
 		} else if (Foreground) {
 			io::fout.printf("power: %7s, load: %4d MHz, cpu.%d.freq: %4d MHz, wanted: %4d MHz\n",
 			                acstate.name,
-			                (group.loadsum / g.samples), group.corei,
+			                (group.loadsum / group.samples), group.corei,
 			                group.sample_freq, wantfreq);
 		}
 	}
 	if (Foreground) { io::fout.flush(); }
 }
 
+/**
+ * Append the inputs and decisions of the last cycle to the journal.
+ *
+ * @param acline
+ *	The AC line state used by the last cycle
+ */
+void update_journal(unsigned int const acline) {
+	auto & journal = *g.journal;
+	journal << g.elapsed.count() << acline;
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto const & group = g.groups[i];
+		journal << group.sample_freq << decikelvin_t{group.temp}
+		        << group.decision;
+	}
+	for (coreid_t i = 0; i < g.ncpu; ++i) {
+		for (size_t state = 0; state < CPUSTATES; ++state) {
+			journal << g.cp_times[i][state] -
+			           g.journal_cp_times[i][state];
+			g.journal_cp_times[i][state] = g.cp_times[i][state];
+		}
+	}
+	journal.commit();
+}
+
 /**
  * Dispatch update_freq<>().
  */
@@ -819,24 +1729,113 @@ void update_freq() {
 	switch ((g.foreground << 2) | (g.temp_throttling << 1) |
 	        (acstate.target_load == 0)) {
 	case 0b000:
-		return update_freq<0, 0, 0>(acstate);
+		update_freq<0, 0, 0>(acstate);
+		break;
 	case 0b001:
-		return update_freq<0, 0, 1>(acstate);
+		update_freq<0, 0, 1>(acstate);
+		break;
 	case 0b010:
-		return update_freq<0, 1, 0>(acstate);
+		update_freq<0, 1, 0>(acstate);
+		break;
 	case 0b011:
-		return update_freq<0, 1, 1>(acstate);
+		update_freq<0, 1, 1>(acstate);
+		break;
 	case 0b100:
-		return update_freq<1, 0, 0>(acstate);
+		update_freq<1, 0, 0>(acstate);
+		break;
 	case 0b101:
-		return update_freq<1, 0, 1>(acstate);
+		update_freq<1, 0, 1>(acstate);
+		break;
 	case 0b110:
-		return update_freq<1, 1, 0>(acstate);
+		update_freq<1, 1, 0>(acstate);
+		break;
 	case 0b111:
-		return update_freq<1, 1, 1>(acstate);
+		update_freq<1, 1, 1>(acstate);
+		break;
+	default:
+		assert(false && "update_freq<>() was not dispatched");
+	}
+
+	if (g.journal) {
+		update_journal(acline);
 	}
+}
+
+/**
+ * Apply pending boost hints.
+ *
+ * Hints exceeding the rate limit are dropped. A boosted core group
+ * is clocked up right away, unless it is running hot. Until the
+ * boost expires update_freq() uses it as the lower clock frequency
+ * limit, so expiry does not cause additional wakeups.
+ *
+ * @param listener
+ *	The boost hint socket
+ */
+void update_hints(hint::Listener const & listener) {
+	using std::chrono::steady_clock;
+	auto const now = steady_clock::now();
+	auto const second = std::chrono::duration_cast<steady_clock::duration>(
+	    std::chrono::seconds{1});
+	auto const step = second / g.hint_rate;
+
+	/* get AC line status */
+	auto const acline = to_value<AcLineState>(
+	    Once{AcLineState::UNKNOWN, g.acline_ctl});
+	auto const & acstate = g.acstates[acline];
 
-	assert(false && "update_freq<>() was not dispatched");
+	for (hint::Request req; listener(req);) {
+		/* rate limit */
+		g.hint_time = std::max(g.hint_time, now);
+		if (g.hint_time - now > second - step) {
+			if (g.foreground) {
+				io::fout.print("boost: rate limit exceeded\n");
+			}
+			continue;
+		}
+		g.hint_time += step;
+
+		auto const duration = std::min(ms{req.duration},
+		                               HINT_DURATION_MAX);
+		for (coreid_t i = 0; i < g.ngroups; ++i) {
+			auto & group = g.groups[i];
+			/* select groups */
+			if (req.core != hint::ALL &&
+			    (req.core < 0 || req.core >= g.ncpu ||
+			     g.cores[req.core].group != &group)) {
+				continue;
+			}
+			/* do not override higher priority boosts */
+			if (group.boost_until > now &&
+			    req.priority < group.boost_priority) {
+				continue;
+			}
+			group.boost = req.freq;
+			group.boost_priority = req.priority;
+			group.boost_until = now + duration;
+
+			/* clock up right away */
+			auto const & classet = g.classes[to_value(group.coreclass)];
+			auto const max = std::min<mhz_t>({group.max, acstate.freq_max,
+			                                  classet.freq_max});
+			auto const min = std::max<mhz_t>({group.min, acstate.freq_min,
+			                                  classet.freq_min});
+			auto const freq = std::min(std::max(min, group.boost), max);
+			if (g.temp_throttling && group.temp > group.temp_high) {
+				continue;
+			}
+			if (freq > group.sample_freq) {
+				apply(group, freq, min, max);
+			}
+			if (g.foreground) {
+				io::fout.printf("boost: cpu.%d.freq: %4d MHz for %d ms, priority: %d\n",
+				                group.corei, freq,
+				                int(duration.count()),
+				                req.priority);
+			}
+		}
+	}
+	if (g.foreground) { io::fout.flush(); }
 }
 
 /**
@@ -862,10 +1861,13 @@ void init_loads() {
 		auto & group = g.groups[groupi];
 
 		/* recalculate target load for controlling groups */
-		load = group.sample_freq * acstate.target_load / 1024;
+		auto const & classet = g.classes[to_value(group.coreclass)];
+		load = group.sample_freq * (classet.target_load
+		                            ? classet.target_load
+		                            : acstate.target_load) / 1024;
 
 		/* apply target load to the whole sample buffer */
-		for (size_t i = 0; i < g.samples; ++i) {
+		for (size_t i = 0; i < group.samples; ++i) {
 			group.loadsum -= group.loads[i];
 			group.loadsum += load;
 			group.loads[i] = load;
@@ -951,6 +1953,28 @@ void set_mode(AcLineState const line, char const * const str) {
 	fail(Exit::EMODE, 0, "mode not recognised: "s + str);
 }
 
+/**
+ * Parses a load target for a core class.
+ *
+ * Unlike the AC line modes a core class only accepts a load target,
+ * fixed frequencies are set through the AC line modes.
+ *
+ * @param str
+ *	A string encoded load
+ * @return
+ *	The load target in the range [1, 1024]
+ * @throws Exception{Exit::EOUTOFRANGE}
+ *	For a load target of 0
+ */
+cptime_t class_load(char const * const str) {
+	auto const target = load(str);
+	if (!target) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "core class load target must be greater than 0: "s + str);
+	}
+	return target;
+}
+
 /**
  * An enum for command line parsing.
  */
@@ -971,11 +1995,29 @@ enum class OE {
 	MODE_UNKNOWN,    /**< Set unknown power source mode */
 	TEMP_CTL,        /**< Override temperature sysctl */
 	IVAL_POLL,       /**< Set polling interval */
+	IVAL_SLACK,      /**< Set timer slack */
 	FILE_PID,        /**< Set pidfile */
 	FLAG_VERBOSE,    /**< Activate verbose output on stderr */
 	FLAG_FOREGROUND, /**< Stay in foreground, log events to stdout */
 	FLAG_NICE,       /**< Treat nice time as idle */
 	CNT_SAMPLES,     /**< Set number of load samples */
+	LOAD_P,          /**< Set P-core load target */
+	LOAD_E,          /**< Set E-core load target */
+	FREQ_RANGE_P,    /**< Set P-core clock frequency range */
+	FREQ_RANGE_E,    /**< Set E-core clock frequency range */
+	CNT_SAMPLES_P,   /**< Set number of P-core load samples */
+	CNT_SAMPLES_E,   /**< Set number of E-core load samples */
+	FLAG_DEFER_E,    /**< Keep E-cores low until P-cores saturate */
+	FLAG_EPP,        /**< Prefer the energy/performance preference */
+	FLAG_HINTS,      /**< Accept boost hints on the default socket */
+	FILE_HINTS,      /**< Accept boost hints on the given socket */
+	CNT_HINT_RATE,   /**< Set the number of boost hints per second */
+	CNT_PERIOD,      /**< Detect periodic loads up to the given period */
+	CNT_VERIFY,      /**< Trust written clock frequencies */
+	IVAL_TURBO,      /**< Gate the turbo clock level */
+	FILE_JOURNAL,    /**< Write a journal of all cycles */
+	CNT_JOURNAL,     /**< Set the journal size limit */
+	FILE_POLICY,     /**< Use a trained policy table */
 	IGNORE,          /**< Legacy settings */
 	OPT_UNKNOWN,     /**< Obligatory */
 	OPT_NOOPT,       /**< Obligatory */
@@ -1012,7 +2054,25 @@ Parameter<OE> const PARAMETERS[]{
 	{OE::HITEMP_RANGE,    'H', "hitemp-range",    "temp:temp", "High temperature range (high:critical)"},
 	{OE::TEMP_CTL,        't', "temperature",     "sysctl",    "Override temperature source sysctl"},
 	{OE::IVAL_POLL,       'p', "poll",            "ival",      "The polling interval"},
+	{OE::IVAL_SLACK,       0 , "slack",           "ival",      "Timer slack for coalescing wakeups"},
 	{OE::CNT_SAMPLES,     's', "samples",         "cnt",       "The number of samples to use"},
+	{OE::LOAD_P,           0 , "p-load",          "load",      "Load target for performance cores"},
+	{OE::LOAD_E,           0 , "e-load",          "load",      "Load target for efficiency cores"},
+	{OE::FREQ_RANGE_P,     0 , "p-range",         "freq:freq", "Performance core frequency range"},
+	{OE::FREQ_RANGE_E,     0 , "e-range",         "freq:freq", "Efficiency core frequency range"},
+	{OE::CNT_SAMPLES_P,    0 , "p-samples",       "cnt",       "The number of performance core samples"},
+	{OE::CNT_SAMPLES_E,    0 , "e-samples",       "cnt",       "The number of efficiency core samples"},
+	{OE::FLAG_DEFER_E,     0 , "defer-e",         "",          "Keep efficiency cores low until performance cores saturate"},
+	{OE::FLAG_EPP,         0 , "epp",             "",          "Prefer the energy/performance preference of HW P-states"},
+	{OE::FLAG_HINTS,       0 , "hints",           "",          "Accept boost hints"},
+	{OE::FILE_HINTS,       0 , "hint-socket",     "file",      "Accept boost hints on the given socket"},
+	{OE::CNT_HINT_RATE,    0 , "hint-rate",       "cnt",       "The number of boost hints accepted per second"},
+	{OE::CNT_PERIOD,       0 , "period",          "cnt",       "Detect periodic loads up to cnt samples long"},
+	{OE::CNT_VERIFY,       0 , "verify",          "cnt",       "Read back the clock frequency every cnt samples"},
+	{OE::IVAL_TURBO,       0 , "turbo",           "ival:ival", "Turbo hold and cooldown time"},
+	{OE::FILE_JOURNAL,     0 , "journal",         "file",      "Journal the inputs and decisions of every cycle"},
+	{OE::CNT_JOURNAL,      0 , "journal-size",    "cnt",       "The journal size limit in MiB"},
+	{OE::FILE_POLICY,      0 , "policy",          "file",      "Use a trained policy table"},
 	{OE::FILE_PID,        'P', "pid",             "file",      "Alternative PID file"},
 	{OE::IGNORE,          'i', "",                "load",      "Ignored"},
 	{OE::IGNORE,          'r', "",                "load",      "Ignored"}
@@ -1031,6 +2091,15 @@ void read_args(int const argc, char const * const argv[]) {
 	auto & ac_batt = g.acstates[to_value(AcLineState::BATTERY)];
 	auto & ac_unknown = g.acstates[to_value(AcLineState::UNKNOWN)];
 
+	auto & p_cores = g.classes[to_value(CoreClass::PERFORMANCE)];
+	auto & e_cores = g.classes[to_value(CoreClass::EFFICIENCY)];
+
+	/* record the command line for the journal */
+	for (int i = 0; i < argc; ++i) {
+		if (i) { g.args += ' '; }
+		g.args += argv[i];
+	}
+
 	try {
 		while (true) switch (getopt()) {
 		case OE::USAGE:
@@ -1095,9 +2164,71 @@ void read_args(int const argc, char const * const argv[]) {
 		case OE::IVAL_POLL:
 			g.interval = ival(getopt[1]);
 			break;
+		case OE::IVAL_SLACK:
+			g.slack = ival(getopt[1]);
+			break;
 		case OE::CNT_SAMPLES:
 			g.samples = samples(getopt[1]);
 			break;
+		case OE::LOAD_P:
+			p_cores.target_load = class_load(getopt[1]);
+			break;
+		case OE::LOAD_E:
+			e_cores.target_load = class_load(getopt[1]);
+			break;
+		case OE::FREQ_RANGE_P:
+			std::tie(p_cores.freq_min, p_cores.freq_max) =
+			    range(freq, getopt[1]);
+			break;
+		case OE::FREQ_RANGE_E:
+			std::tie(e_cores.freq_min, e_cores.freq_max) =
+			    range(freq, getopt[1]);
+			break;
+		case OE::CNT_SAMPLES_P:
+			p_cores.samples = samples(getopt[1]);
+			break;
+		case OE::CNT_SAMPLES_E:
+			e_cores.samples = samples(getopt[1]);
+			break;
+		case OE::FLAG_DEFER_E:
+			g.defer_efficiency = true;
+			break;
+		case OE::FLAG_EPP:
+			g.epp = true;
+			break;
+		case OE::FLAG_HINTS:
+			g.hint_socket = HINT_SOCKET;
+			break;
+		case OE::FILE_HINTS:
+			g.hint_socket = getopt[1];
+			break;
+		case OE::CNT_HINT_RATE:
+			g.hint_rate = count(getopt[1], HINT_RATE_MAX);
+			break;
+		case OE::CNT_PERIOD:
+			g.period = samples(getopt[1]);
+			if (g.period < 2) {
+				fail(Exit::EOUTOFRANGE, 0,
+				     "the period must be at least 2 samples");
+			}
+			break;
+		case OE::CNT_VERIFY:
+			g.verify = count(getopt[1], VERIFY_MAX);
+			break;
+		case OE::IVAL_TURBO:
+			g.turbo = true;
+			std::tie(g.turbo_hold, g.turbo_cooldown) =
+			    range(ival, getopt[1]);
+			break;
+		case OE::FILE_JOURNAL:
+			g.journal_file = getopt[1];
+			break;
+		case OE::CNT_JOURNAL:
+			g.journal_size = count(getopt[1], JOURNAL_SIZE_MAX);
+			break;
+		case OE::FILE_POLICY:
+			g.policy_file = getopt[1];
+			break;
 		case OE::FILE_PID:
 			g.pidfilename = getopt[1];
 			break;
@@ -1111,6 +2242,11 @@ void read_args(int const argc, char const * const argv[]) {
 			fail(Exit::ECLARG, 0,
 			     "unexpected command line argument");
 		case OE::OPT_DONE:
+			/* slack would skip entire polling intervals */
+			if (g.slack.count() && g.slack >= g.interval) {
+				fail(Exit::EOUTOFRANGE, 0,
+				     "the timer slack must be shorter than the polling interval");
+			}
 			return;
 		}
 	} catch (Exception & e) {
@@ -1135,11 +2271,18 @@ void show_settings() {
 	                "Load Sampling\n"
 	                "\tload samples:          %d\n"
 	                "\tpolling interval:      %d ms\n"
-	                "\tload average over:     %d ms\n"
-	                "Frequency Limits\n",
+	                "\ttimer slack:           %d ms\n"
+	                "\tload average over:     %d ms\n",
 	                g.foreground ? "yes" : "no",
-	                g.samples, g.interval.count(),
+	                g.samples, g.interval.count(), g.slack.count(),
 	                g.samples * g.interval.count());
+	if (g.verify) {
+		io::ferr.printf("\tread clock every:      %zu samples\n",
+		                g.verify);
+	} else {
+		io::ferr.print("\tread clock every:      sample\n");
+	}
+	io::ferr.print("Frequency Limits\n");
 	for (auto const & acstate : g.acstates) {
 		io::ferr.printf("\t%-22s [%d MHz, %d MHz]\n",
 		                (""s + acstate.name + ':').c_str(),
@@ -1147,19 +2290,57 @@ void show_settings() {
 	}
 	io::ferr.printf("CPU Cores\n"
 	                "\tCPU cores:             %d\n"
-	                "Core Groups\n", g.ncpu);
+	                "\tCPU packages:          %d\n"
+	                "Core Groups\n", g.ncpu, g.npackages);
 	assert(g.groups && g.ngroups);
-	for (coreid_t gid = 0, b = 0, e = 1; e <= g.ncpu; ++e) {
-		if (e == g.ncpu || g.cores[b].group != g.cores[e].group) {
-			io::ferr.printf("\t%3d:                   [%d, %d]\n", gid++, b, e - 1);
-			b = e;
+	for (coreid_t gid = 0; gid < g.ngroups; ++gid) {
+		auto const group = &g.groups[gid];
+		io::ferr.printf("\t%3d:                  ", gid);
+		/* print ranges of cores, groups need not be contiguous */
+		for (coreid_t b = 0, e = 0; b < g.ncpu; b = e) {
+			if (g.cores[b].group != group) {
+				e = b + 1;
+				continue;
+			}
+			e = b + 1;
+			while (e < g.ncpu && g.cores[e].group == group) { ++e; }
+			io::ferr.printf(" [%d, %d]", b, e - 1);
 		}
+		if (g.npackages > 1) {
+			io::ferr.printf(" package %d", group->package);
+		}
+		io::ferr.putc('\n');
 	}
 	io::ferr.print("Core Group Frequency Limits\n");
 	for (coreid_t i = 0; i < g.ngroups; ++i) {
 		io::ferr.printf("\t%3d:                   [%d MHz, %d MHz]\n",
 		                i, g.groups[i].min, g.groups[i].max);
 	}
+	io::ferr.print("Core Group Clock Control\n");
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto const & group = g.groups[i];
+		char name[40];
+		sprintf_safe(name, group.actuator.backend() == Backend::EPP
+		                   ? EPP : FREQ, group.corei);
+		io::ferr.printf("\t%3d:                   %s\n", i, name);
+	}
+	io::ferr.print("Turbo\n");
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		auto const & group = g.groups[i];
+		if (group.turbo) {
+			io::ferr.printf("\t%3d:                   %d MHz\n",
+			                i, group.turbo);
+		} else {
+			io::ferr.printf("\t%3d:                   none\n", i);
+		}
+	}
+	if (g.turbo) {
+		io::ferr.printf("\thold:                  %d ms\n"
+		                "\tcooldown:              %d ms\n",
+		                g.turbo_hold.count(), g.turbo_cooldown.count());
+	} else {
+		io::ferr.print("\tgated:                 no\n");
+	}
 	io::ferr.print("Load Targets\n");
 	for (auto const & acstate : g.acstates) {
 		io::ferr.printf("\t%-22s",
@@ -1170,6 +2351,53 @@ void show_settings() {
 			io::ferr.printf(" %4d MHz\n", acstate.target_freq);
 		}
 	}
+	io::ferr.print("Core Classes\n");
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		io::ferr.printf("\t%3d:                   %s\n", i,
+		                g.classes[to_value(g.groups[i].coreclass)].name);
+	}
+	for (auto const & coreclass : g.classes) {
+		io::ferr.printf("\t%-22s [%d MHz, %d MHz], ",
+		                (""s + coreclass.name + ':').c_str(),
+		                coreclass.freq_min, coreclass.freq_max);
+		if (coreclass.target_load) {
+			io::ferr.printf("%2d %% load, ",
+			                (coreclass.target_load * 100 + 512) / 1024);
+		}
+		io::ferr.printf("%zu samples\n", coreclass.samples
+		                                 ? coreclass.samples
+		                                 : g.samples);
+	}
+	io::ferr.printf("\tdefer efficiency:      %s\n",
+	                g.defer_efficiency ? "yes" : "no");
+	io::ferr.print("Periodic Load Detection\n");
+	if (g.period) {
+		io::ferr.printf("\tmaximum period:        %d ms\n"
+		                "\tcorrelation window:    %d ms\n",
+		                g.period * g.interval.count(),
+		                2 * g.period * g.interval.count());
+	} else {
+		io::ferr.print("\tactive:                no\n");
+	}
+	io::ferr.print("Journal\n");
+	if (g.journal_file) {
+		io::ferr.printf("\tfile:                  %s\n"
+		                "\tsize limit:            %d MiB\n",
+		                g.journal_file, g.journal_size);
+	} else {
+		io::ferr.print("\tactive:                no\n");
+	}
+	io::ferr.print("Policy Table\n");
+	if (g.policy) {
+		auto const & head = g.policy.header();
+		io::ferr.printf("\tfile:                  %s\n"
+		                "\ttrained samples:       %d\n"
+		                "\tbins:                  %d load, %d trend, %d temperature\n",
+		                g.policy_file, head.samples, head.load_bins,
+		                head.trend_bins, head.temp_bins);
+	} else {
+		io::ferr.print("\tactive:                no\n");
+	}
 	io::ferr.print("Temperature Throttling\n");
 	if (g.temp_throttling) {
 		io::ferr.printf("\tactive:                yes\n"
@@ -1185,34 +2413,132 @@ void show_settings() {
 	}
 }
 
+/**
+ * Returns the load recording header describing the system.
+ *
+ * This resembles the header loadrec(1) creates, so a journal can
+ * be converted into a load recording.
+ *
+ * @return
+ *	The header lines
+ */
+std::string journal_sysctls() {
+	std::string result;
+	auto const line = [&result](char const * const name,
+	                            std::string const & value) {
+		((result += name) += '=') += value;
+		result += '\n';
+	};
+	auto const ctl = [&line](char const * const name) {
+		try {
+			line(name, Sysctl<0>{name}.get<char>().get());
+		} catch (sys::sc_error<sys::ctl::error>) {
+			verbose("cannot access sysctl: %s\n", name);
+		}
+	};
+
+	flag_t const features{1_FREQ_TRACKING | 1_DURATION_US |
+	                      1_ACLINE_TRACKING |
+	                      (g.temp_throttling ? 1_TEMP_TRACKING : 0)};
+	line(LOADREC_FEATURES, std::to_string(features));
+	ctl("hw.machine");
+	ctl("hw.model");
+	line("hw.ncpu", std::to_string(g.ncpu));
+	line(ACLINE, std::to_string(to_value<AcLineState>(
+	    Once{AcLineState::UNKNOWN, g.acline_ctl})));
+	try {
+		auto const topology = Sysctl<0>{TOPOLOGY}.get<char>();
+		for (auto pch = topology.get(); *pch; ++pch) {
+			if (*pch == '\n') { *pch = ' '; }
+		}
+		line(TOPOLOGY, topology.get());
+	} catch (sys::sc_error<sys::ctl::error>) {
+		verbose("cannot access sysctl: %s\n", TOPOLOGY);
+	}
+	for (coreid_t i = 0; i < g.ncpu; ++i) {
+		auto const & group = *g.cores[i].group;
+		char name[40];
+		if (g.temp_throttling) {
+			sprintf_safe(name, TEMPERATURE, i);
+			line(name, std::to_string(g.cores[i].temp));
+			sprintf_safe(name, TJMAX_SOURCES[0], i);
+			line(name, std::to_string(group.temp_crit));
+		}
+		if (group.corei != i) {
+			continue;
+		}
+		sprintf_safe(name, FREQ, i);
+		line(name, std::to_string(group.freq));
+		sprintf_safe(name, FREQ_LEVELS, i);
+		ctl(name);
+		sprintf_safe(name, FREQ_DRIVER, i);
+		ctl(name);
+	}
+	return result;
+}
+
+/**
+ * Start the journal.
+ *
+ * @throws sys::sc_error<journal::error>
+ *	If the journal cannot be written
+ */
+void init_journal() {
+	journal::Header head{};
+	head.flags = g.temp_throttling ? uint32_t{journal::TEMPERATURE} : 0;
+	head.ncpu = g.ncpu;
+	head.ngroups = g.ngroups;
+	head.states = CPUSTATES;
+	std::vector<uint16_t> groups(g.ncpu);
+	for (coreid_t i = 0; i < g.ncpu; ++i) {
+		groups[i] = g.cores[i].group - g.groups.get();
+	}
+	std::vector<uint16_t> corei(g.ngroups);
+	for (coreid_t i = 0; i < g.ngroups; ++i) {
+		corei[i] = g.groups[i].corei;
+	}
+	g.journal = std::make_unique<journal::Writer>(
+	    g.journal_file, g.journal_size << 20,
+	    journal::serialise(head, groups, corei, journal_sysctls(),
+	                       g.args));
+
+	/* the first record contains the absolute tick counts */
+	g.journal_cp_times = std::unique_ptr<cptime_t[][CPUSTATES]>{
+		new cptime_t[g.ncpu][CPUSTATES]{}};
+}
+
 /**
  * A core frequency guard.
  *
  * This uses the RAII pattern to achieve two things:
  *
  * - Upon creation it reads and writes all controlling cores
- * - Upon destruction it sets all cores to the maximum frequencies
+ * - Upon destruction it restores the initial clock frequencies, or
+ *   the initial energy/performance preferences of EPP groups
  */
 class FreqGuard final {
 	private:
 	/**
-	 * The list of initial frequencies.
+	 * The list of initial frequencies or EPP values.
 	 */
-	std::unique_ptr<mhz_t[]> freqs;
+	std::unique_ptr<int[]> values;
 
 	public:
 	/**
-	 * Read and write all core frequencies, may throw.
+	 * Read and write all core frequencies or EPP values, may throw.
+	 *
+	 * EPP groups do not support writing dev.cpu.%d.freq, so their
+	 * energy/performance preference is guarded instead.
 	 */
-	FreqGuard() : freqs{new mhz_t[g.ngroups]} {
+	FreqGuard() : values{new int[g.ngroups]} {
 		assert(g.groups);
 		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
-			auto & group = g.groups[groupi];
+			auto & actuator = g.groups[groupi].actuator;
 			try {
-				/* remember clock frequency */
-				this->freqs[groupi] = group.freq;
-				/* attempt clock frequency write */
-				group.freq = this->freqs[groupi];
+				/* remember clock frequency or EPP */
+				this->values[groupi] = actuator.read();
+				/* attempt write */
+				actuator.write(this->values[groupi]);
 			} catch (sys::sc_error<sys::ctl::error> e) {
 				if (EPERM == e) {
 					fail(Exit::EFORBIDDEN, e,
@@ -1225,13 +2551,13 @@ class FreqGuard final {
 	}
 
 	/**
-	 * Restore all core frequencies.
+	 * Restore all core frequencies or EPP values.
 	 */
 	~FreqGuard() {
 		for (coreid_t groupi = 0; groupi < g.ngroups; ++groupi) {
-			auto & group = g.groups[groupi];
+			auto & actuator = g.groups[groupi].actuator;
 			try {
-				group.freq = this->freqs[groupi];
+				actuator.write(this->values[groupi]);
 			} catch (sys::sc_error<sys::ctl::error>) {
 				/* do nada */
 			}
@@ -1239,16 +2565,6 @@ class FreqGuard final {
 	}
 };
 
-/**
- * Sets g.signal, terminating the main loop.
- *
- * @param signal
- *	The signal number received
- */
-void signal_recv(int signal) {
-	g.signal = signal;
-}
-
 /**
  * Daemonise and run the main loop.
  */
@@ -1259,15 +2575,35 @@ void run_daemon() try {
 	/* try to set frequencies once, before detaching from the terminal */
 	FreqGuard fguard;
 
+	/* start the journal */
+	if (g.journal_file) try {
+		init_journal();
+	} catch (sys::sc_error<journal::error> e) {
+		fail(Exit::EWOPEN, e,
+		     "cannot write journal: "s += sanitise(g.journal_file));
+	}
+
 	/* detach from the terminal */
 	if (!g.foreground && -1 == ::daemon(0, 1)) {
 		fail(Exit::EDAEMON, errno, "detaching the process failed");
 	}
 
-	/* setup signal handlers */
-	sys::sig::Signal sigint{SIGINT, signal_recv};
-	sys::sig::Signal sigterm{SIGTERM, signal_recv};
-	sys::sig::Signal sighup{SIGHUP, (g.foreground ? signal_recv : SIG_IGN)};
+	/* setup the event reactor and signal delivery */
+	sys::event::Reactor reactor{g.slack};
+	sys::sig::Signal sigint{SIGINT, reactor};
+	sys::sig::Signal sigterm{SIGTERM, reactor};
+	sys::sig::Signal sighup{SIGHUP, reactor};
+
+	/* setup the boost hint socket */
+	std::unique_ptr<hint::Listener> hints{nullptr};
+	if (g.hint_socket) try {
+		hints = std::make_unique<hint::Listener>(g.hint_socket, 0660);
+		reactor.watch(hints->fileno());
+	} catch (sys::sc_error<hint::error> e) {
+		fail(Exit::ESOCKET, e,
+		     "cannot create boost hint socket: "s +=
+		     sanitise(g.hint_socket));
+	}
 
 	/* write pid */
 	try {
@@ -1278,9 +2614,29 @@ void run_daemon() try {
 	}
 
 	/* the main loop */
-	timing::Cycle sleep;
-	while (!g.signal && sleep(g.interval)) {
-		update_freq();
+	timing::Cycle sleep{timing::Cycle::catchup::skip};
+	for (auto ev = sleep(reactor, g.interval); !g.signal;) {
+		switch (ev.what) {
+		case sys::event::type::timeout:
+			g.elapsed = sleep.elapsed();
+			update_freq();
+			ev = sleep(reactor, g.interval);
+			break;
+		case sys::event::type::signal:
+			/* SIGHUP only terminates in foreground mode */
+			if (ev.ident != SIGHUP || g.foreground) {
+				g.signal = ev.ident;
+				break;
+			}
+			ev = sleep(reactor);
+			break;
+		case sys::event::type::read:
+			if (hints && ev.ident == hints->fileno()) {
+				update_hints(*hints);
+			}
+			ev = sleep(reactor);
+			break;
+		}
 	}
 
 	verbose("signal %d received, exiting ...\n", g.signal);
@@ -1293,6 +2649,9 @@ void run_daemon() try {
 } catch (sys::sc_error<sys::sig::error> e) {
 	fail(Exit::ESIGNAL, e,
 	     "failed to register signal handler: "s + e.c_str());
+} catch (sys::sc_error<sys::event::error> e) {
+	fail(Exit::EEVENT, e,
+	     "failed to set up the event reactor: "s + e.c_str());
 }
 
 } /* namespace */
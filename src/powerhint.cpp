@@ -0,0 +1,194 @@
+/**
+ * Implements powerhint, a client for the powerd++ boost hint socket.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+
+#include "constants.hpp"
+#include "errors.hpp"
+#include "utility.hpp"
+#include "clas.hpp"
+#include "hint.hpp"
+
+#include "sys/io.hpp"
+
+#include <cstdlib>   /* strtol() */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+using constants::HINT_SOCKET;
+using constants::HINT_DURATION_MAX;
+
+namespace io = sys::io;
+
+using utility::to_value;
+using clas::freq;
+using clas::ival;
+using namespace utility::literals;
+
+using namespace std::literals::string_literals;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,           /**< Print help */
+	FILE_SOCKET,     /**< Set the socket path */
+	CNT_CORE,        /**< Set the core to boost */
+	CNT_PRIORITY,    /**< Set the request priority */
+	FREQ_BOOST,      /**< Set the minimum clock frequency */
+	IVAL_DURATION,   /**< Set the boost duration */
+	OPT_UNKNOWN,     /**< Obligatory */
+	OPT_NOOPT,       /**< Obligatory */
+	OPT_DASH,        /**< Obligatory */
+	OPT_LDASH,       /**< Obligatory */
+	OPT_DONE         /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-h] [-S file] [-c cnt] [-p cnt] [-d ival] -f freq";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,         'h', "help",     "",     "Show usage and exit"},
+	{OE::FILE_SOCKET,   'S', "socket",   "file", "The powerd++ boost hint socket"},
+	{OE::CNT_CORE,      'c', "core",     "cnt",  "Boost the core group of the given core"},
+	{OE::CNT_PRIORITY,  'p', "priority", "cnt",  "The request priority [0, 255]"},
+	{OE::FREQ_BOOST,    'f', "freq",     "freq", "The minimum clock frequency"},
+	{OE::IVAL_DURATION, 'd', "duration", "ival", "The boost duration (default 1s)"},
+};
+
+/**
+ * Convert a string to an integer in the given range.
+ *
+ * @param str
+ *	The string to convert
+ * @param min,max
+ *	The range of valid values
+ * @return
+ *	The integer value
+ * @throws errors::Exception{Exit::EOUTOFRANGE}
+ *	If the string is not an integer in the given range
+ */
+long integer(char const * const str, long const min, long const max) {
+	char * end{nullptr};
+	auto const value = std::strtol(str, &end, 10);
+	if (!*str || *end || value < min || value > max) {
+		fail(Exit::EOUTOFRANGE, 0,
+		     "integer in the range [%ld, %ld] expected: %s"_fmt
+		     (min, max, str));
+	}
+	return value;
+}
+
+} /* namespace */
+
+/**
+ * Parse command line arguments and send a boost hint.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	char const * path{HINT_SOCKET};
+	hint::Request req{};
+	req.duration = 1000;
+	bool boost{false};
+
+	try {
+		while (true) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FILE_SOCKET:
+			path = getopt[1];
+			break;
+		case OE::CNT_CORE:
+			req.core = integer(getopt[1], 0, 0x7fffffff);
+			break;
+		case OE::CNT_PRIORITY:
+			req.priority = integer(getopt[1], 0, 255);
+			break;
+		case OE::FREQ_BOOST:
+			req.freq = freq(getopt[1]);
+			boost = true;
+			break;
+		case OE::IVAL_DURATION: {
+			auto const duration = ival(getopt[1]);
+			if (duration > HINT_DURATION_MAX) {
+				fail(Exit::EOUTOFRANGE, 0,
+				     "boost duration must not exceed %d ms"_fmt
+				     (int(HINT_DURATION_MAX.count())));
+			}
+			req.duration = duration.count();
+			break;
+		}
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+			break;
+		case OE::OPT_DONE:
+			if (!boost) {
+				fail(Exit::ECLARG, 0,
+				     "a boost frequency is required");
+			}
+			hint::Client{path}(req);
+			return to_value(Exit::OK);
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FILE_SOCKET:
+		case OE::CNT_CORE:
+		case OE::CNT_PRIORITY:
+		case OE::FREQ_BOOST:
+		case OE::IVAL_DURATION:
+			e.msg += "\n\n"s += getopt.show(1);
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_NOOPT:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+		case OE::OPT_DONE:
+			e.msg += "\n\n"s += getopt.show(0);
+			break;
+		}
+		throw;
+	}
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("powerhint: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (sys::sc_error<hint::error> e) {
+	io::ferr.printf("powerhint: cannot send boost hint: %s\n", e.c_str());
+	return to_value(Exit::ESOCKET);
+} catch (...) {
+	io::ferr.print("powerhint: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
@@ -0,0 +1,422 @@
+/**
+ * Implements an event reactor around kqueue(2).
+ *
+ * On Linux epoll(7), timerfd_create(2) and signalfd(2) are used
+ * instead.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_SYS_EVENT_HPP_
+#define _POWERDXX_SYS_EVENT_HPP_
+
+#include "error.hpp"    /* sys::sc_error */
+
+#include <algorithm>    /* std::max() */
+#include <chrono>       /* std::chrono::steady_clock */
+#include <cerrno>       /* errno, EINTR */
+#include <csignal>      /* ::signal() */
+#include <cstdint>      /* uint64_t */
+
+#include <unistd.h>     /* close(), read() */
+
+#ifdef __linux__
+#include <sys/epoll.h>     /* epoll_create1(), epoll_ctl(), epoll_wait() */
+#include <sys/timerfd.h>   /* timerfd_create(), timerfd_settime() */
+#include <sys/signalfd.h>  /* signalfd() */
+#else
+#include <sys/event.h>     /* kqueue(), kevent() */
+#endif
+
+namespace sys {
+
+/**
+ * This namespace provides an event reactor for timers, signals and
+ * file descriptors.
+ */
+namespace event {
+
+/**
+ * The domain error type.
+ */
+struct error {};
+
+/**
+ * The kinds of events the reactor reports.
+ */
+enum class type {
+	timeout, /**< The deadline was reached */
+	signal,  /**< A watched signal was received */
+	read,    /**< A watched file descriptor is readable */
+};
+
+/**
+ * An event reported by the reactor.
+ */
+struct Event {
+	/**
+	 * The kind of event.
+	 */
+	type what;
+
+	/**
+	 * The signal number or file descriptor, 0 for timeouts.
+	 */
+	int ident;
+};
+
+/**
+ * Waits for deadlines, signals and readable file descriptors.
+ *
+ * All wakeups of a process go through a single wait() call, so new
+ * inputs can be added without restructuring a sleep based loop.
+ *
+ * Deadlines are absolute, so the waking rhythm does not drift when
+ * a wait is interrupted by other events. A timer slack can be set,
+ * deadlines are rounded up to a multiple of the slack, which aligns
+ * wakeups with other timers and lets the kernel coalesce them.
+ */
+class Reactor {
+	public:
+	/**
+	 * Use steady_clock, avoid time jumps.
+	 */
+	using clock = std::chrono::steady_clock;
+
+	/**
+	 * Convenience type for signal handlers.
+	 */
+	using handler_t = void (*)(int);
+
+	private:
+	/**
+	 * The kqueue(2) or epoll(7) file descriptor.
+	 */
+	int fd{-1};
+
+#ifdef __linux__
+	/**
+	 * The timerfd_create(2) file descriptor for deadlines.
+	 */
+	int tfd{-1};
+
+	/**
+	 * The signalfd(2) file descriptor for watched signals.
+	 */
+	int sfd{-1};
+
+	/**
+	 * The set of watched signals.
+	 */
+	sigset_t sigs;
+#endif
+
+	/**
+	 * The timer slack.
+	 */
+	clock::duration const slack;
+
+	/**
+	 * Round a deadline up to the timer slack.
+	 *
+	 * @param deadline
+	 *	The deadline to round
+	 * @return
+	 *	The first multiple of the slack not before the deadline
+	 */
+	clock::time_point round(clock::time_point const deadline) const {
+		if (this->slack <= clock::duration::zero()) {
+			return deadline;
+		}
+		auto const since = deadline.time_since_epoch();
+		return clock::time_point{
+			(since + this->slack - clock::duration{1}) /
+			this->slack * this->slack
+		};
+	}
+
+	/**
+	 * Add or remove a watched event.
+	 *
+	 * @param ident
+	 *	The file descriptor or signal to watch
+	 * @param sig
+	 *	Whether the event is a signal or a file descriptor, the
+	 *	epoll(7) implementation only supports file descriptors
+	 * @param add
+	 *	Whether to add or remove the event
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of kevent() or epoll_ctl()
+	 */
+	void control(int const ident, [[maybe_unused]] bool const sig,
+	             bool const add) {
+#ifdef __linux__
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.fd = ident;
+		if (-1 == epoll_ctl(this->fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_DEL,
+		                    ident, &ev)) {
+			throw sc_error<error>{errno};
+		}
+#else
+		struct kevent ev;
+		EV_SET(&ev, ident, sig ? EVFILT_SIGNAL : EVFILT_READ,
+		       add ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+		if (-1 == kevent(this->fd, &ev, 1, nullptr, 0, nullptr)) {
+			throw sc_error<error>{errno};
+		}
+#endif
+	}
+
+	/**
+	 * Close all file descriptors.
+	 */
+	void close() {
+#ifdef __linux__
+		for (auto const desc : {this->sfd, this->tfd}) {
+			if (desc != -1) {
+				::close(desc);
+			}
+		}
+#endif
+		if (this->fd != -1) {
+			::close(this->fd);
+		}
+	}
+
+	public:
+	/**
+	 * Set up the reactor.
+	 *
+	 * @tparam DurTraits
+	 *	The traits of the duration type
+	 * @param slack
+	 *	The timer slack
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of kqueue() or one of the epoll(7),
+	 *	timerfd_create(2) or signalfd(2) calls
+	 */
+	template <class... DurTraits>
+	explicit Reactor(std::chrono::duration<DurTraits...> const & slack) :
+	    slack{std::chrono::duration_cast<clock::duration>(slack)} {
+#ifdef __linux__
+		sigemptyset(&this->sigs);
+		if (-1 == (this->fd = epoll_create1(EPOLL_CLOEXEC)) ||
+		    -1 == (this->tfd = timerfd_create(CLOCK_MONOTONIC,
+		                                      TFD_CLOEXEC)) ||
+		    -1 == (this->sfd = signalfd(-1, &this->sigs, SFD_CLOEXEC))) {
+			auto const err = errno;
+			close();
+			throw sc_error<error>{err};
+		}
+		try {
+			control(this->tfd, false, true);
+			control(this->sfd, false, true);
+		} catch (...) {
+			close();
+			throw;
+		}
+#else
+		if (-1 == (this->fd = kqueue())) {
+			throw sc_error<error>{errno};
+		}
+#endif
+	}
+
+	/**
+	 * Set up the reactor without timer slack.
+	 *
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of the underlying calls
+	 */
+	Reactor() : Reactor{clock::duration::zero()} {}
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 */
+	Reactor(Reactor const &) = delete;
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 *
+	 * @return
+	 *	A self reference
+	 */
+	Reactor & operator =(Reactor const &) = delete;
+
+	/**
+	 * Close the reactor.
+	 */
+	~Reactor() {
+		close();
+	}
+
+	/**
+	 * Start watching a signal.
+	 *
+	 * The signal disposition is changed so the signal is reported
+	 * by wait() instead of being handled asynchronously. For kqueue(2)
+	 * the signal is ignored, for signalfd(2) it is blocked.
+	 *
+	 * @param sig
+	 *	The signal to watch
+	 * @return
+	 *	The previous signal handler, SIG_ERR on failure
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of the underlying calls
+	 */
+	handler_t signal(int const sig) {
+#ifdef __linux__
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, sig);
+		sigaddset(&this->sigs, sig);
+		if (-1 == signalfd(this->sfd, &this->sigs, 0) ||
+		    -1 == sigprocmask(SIG_BLOCK, &set, nullptr)) {
+			sigdelset(&this->sigs, sig);
+			throw sc_error<error>{errno};
+		}
+		return ::signal(sig, SIG_DFL);
+#else
+		control(sig, true, true);
+		return ::signal(sig, SIG_IGN);
+#endif
+	}
+
+	/**
+	 * Stop watching a signal.
+	 *
+	 * The caller is responsible for restoring the signal disposition.
+	 *
+	 * @param sig
+	 *	The signal to stop watching
+	 */
+	void unsignal(int const sig) {
+#ifdef __linux__
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, sig);
+		sigdelset(&this->sigs, sig);
+		signalfd(this->sfd, &this->sigs, 0);
+		sigprocmask(SIG_UNBLOCK, &set, nullptr);
+#else
+		try {
+			control(sig, true, false);
+		} catch (sc_error<error>) {
+			/* do nada */
+		}
+#endif
+	}
+
+	/**
+	 * Start watching a file descriptor for input.
+	 *
+	 * @param desc
+	 *	The file descriptor to watch
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of kevent() or epoll_ctl()
+	 */
+	void watch(int const desc) {
+		control(desc, false, true);
+	}
+
+	/**
+	 * Stop watching a file descriptor.
+	 *
+	 * This must be called before the file descriptor is closed.
+	 *
+	 * @param desc
+	 *	The file descriptor to stop watching
+	 */
+	void unwatch(int const desc) {
+		try {
+			control(desc, false, false);
+		} catch (sc_error<error>) {
+			/* do nada */
+		}
+	}
+
+	/**
+	 * Wait for an event or the given deadline.
+	 *
+	 * Only a single event is reported per call, pending events
+	 * are reported by subsequent calls. Waiting for the same
+	 * deadline again after an event completes the wait.
+	 *
+	 * @param deadline
+	 *	The absolute time to wait for
+	 * @return
+	 *	The event that ended the wait
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of the underlying calls
+	 */
+	Event wait(clock::time_point const deadline) {
+		using namespace std::chrono;
+		auto const until = round(deadline);
+#ifdef __linux__
+		/* steady_clock is CLOCK_MONOTONIC */
+		auto const ns = duration_cast<nanoseconds>(
+		    until.time_since_epoch()).count();
+		itimerspec const spec{{0, 0}, {time_t(ns / 1000000000),
+		                               long(ns % 1000000000)}};
+		if (-1 == timerfd_settime(this->tfd, TFD_TIMER_ABSTIME, &spec,
+		                          nullptr)) {
+			throw sc_error<error>{errno};
+		}
+		while (true) {
+			epoll_event ev;
+			if (-1 == epoll_wait(this->fd, &ev, 1, -1)) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw sc_error<error>{errno};
+			}
+			if (ev.data.fd == this->tfd) {
+				uint64_t expirations;
+				if (::read(this->tfd, &expirations,
+				           sizeof(expirations)) > 0) {
+					return {type::timeout, 0};
+				}
+				continue;
+			}
+			if (ev.data.fd == this->sfd) {
+				signalfd_siginfo info;
+				if (::read(this->sfd, &info, sizeof(info)) ==
+				    sizeof(info)) {
+					return {type::signal, int(info.ssi_signo)};
+				}
+				continue;
+			}
+			return {type::read, ev.data.fd};
+		}
+#else
+		while (true) {
+			auto const ns = duration_cast<nanoseconds>(
+			    std::max(until - clock::now(),
+			             clock::duration::zero())).count();
+			timespec const timeout{time_t(ns / 1000000000),
+			                       long(ns % 1000000000)};
+			struct kevent ev;
+			auto const count = kevent(this->fd, nullptr, 0, &ev, 1,
+			                          &timeout);
+			if (count > 0) {
+				return {ev.filter == EVFILT_SIGNAL ? type::signal
+				                                   : type::read,
+				        int(ev.ident)};
+			}
+			if (count == 0 && clock::now() >= until) {
+				return {type::timeout, 0};
+			}
+			if (count == -1 && errno != EINTR) {
+				throw sc_error<error>{errno};
+			}
+		}
+#endif
+	}
+};
+
+} /* namespace event */
+
+} /* namespace sys */
+
+#endif /* _POWERDXX_SYS_EVENT_HPP_ */
@@ -8,7 +8,15 @@
 #define _POWERDXX_SYS_IO_HPP_
 
 #include <cstdio>       /* fopen(), fprintf() etc. */
+#include <cstring>      /* strlen(), memcpy() */
+#include <cmath>        /* std::llround() */
 #include <utility>      /* std::swap() */
+#include <type_traits>  /* std::is_integral */
+#include <charconv>     /* std::to_chars() */
+
+#include <sys/types.h>  /* ssize_t */
+#include <sys/stat.h>   /* fstat() */
+#include <sys/mman.h>   /* mmap(), madvise(), munmap() */
 
 namespace sys {
 
@@ -43,6 +51,13 @@ enum class feature {
 	 * @see file_feature<FileT, seek, Tail ...>
 	 */
 	seek,
+
+	/**
+	 * The file type supports read-only memory mapping.
+	 *
+	 * @see file_feature<FileT, mmap, Tail ...>
+	 */
+	mmap,
 };
 
 /** @copydoc feature::read */
@@ -51,6 +66,8 @@ static constexpr auto const read = feature::read;
 static constexpr auto const write = feature::write;
 /** @copydoc feature::seek */
 static constexpr auto const seek = feature::seek;
+/** @copydoc feature::mmap */
+static constexpr auto const mmap = feature::mmap;
 
 /**
  * Ownership relation to the underlying FILE object.
@@ -76,6 +93,138 @@ static constexpr auto const own = ownership::own;
 /** @copydoc ownership::link */
 static constexpr auto const link = ownership::link;
 
+/**
+ * A fixed-point value for output with file::put().
+ *
+ * @tparam Decimals
+ *	The number of decimal places to output
+ */
+template <unsigned Decimals>
+struct fixed {
+	static_assert(Decimals <= 18, "too many decimal places");
+
+	/**
+	 * The value, it is rounded to the given decimal places.
+	 */
+	double value;
+};
+
+/**
+ * A read-only memory mapping of a whole file.
+ *
+ * The mapping is released when the instance goes out of scope. An
+ * empty mapping indicates that the file could not be mapped.
+ *
+ * @see file_feature<FileT, mmap, Tail ...>
+ */
+class mapping {
+	private:
+	/**
+	 * The start address of the mapping.
+	 */
+	void * addr;
+
+	/**
+	 * The length of the mapping in bytes.
+	 */
+	std::size_t len;
+
+	public:
+	/**
+	 * Construct from a mapped memory range, take ownership.
+	 *
+	 * @param addr,len
+	 *	The mapped memory range
+	 */
+	mapping(void * const addr, std::size_t const len) :
+	    addr{addr}, len{len} {}
+
+	/**
+	 * Default construct an empty mapping.
+	 */
+	mapping() : mapping{nullptr, 0} {}
+
+	/**
+	 * Must not copy construct for risk of multiple munmap() on
+	 * the same memory range.
+	 */
+	mapping(mapping const &) = delete;
+
+	/**
+	 * Move construct from a temporary.
+	 *
+	 * @param move
+	 *	The rvalue mapping to acquire the memory range from
+	 */
+	mapping(mapping && move) : mapping{} {
+		std::swap(this->addr, move.addr);
+		std::swap(this->len, move.len);
+	}
+
+	/**
+	 * Release the memory range.
+	 */
+	~mapping() {
+		if (this->addr) {
+			munmap(this->addr, this->len);
+		}
+	}
+
+	/**
+	 * Move assign from a temporary.
+	 *
+	 * @param move
+	 *	The rvalue mapping to acquire the memory range from
+	 * @return
+	 *	A self reference
+	 */
+	mapping & operator =(mapping && move) {
+		std::swap(this->addr, move.addr);
+		std::swap(this->len, move.len);
+		return *this;
+	}
+
+	/**
+	 * Returns whether a memory range is mapped.
+	 *
+	 * @return
+	 *	Whether the file contents are available
+	 */
+	explicit operator bool() const {
+		return this->addr;
+	}
+
+	/**
+	 * Returns the first character of the file.
+	 *
+	 * @return
+	 *	A pointer to the beginning of the file contents
+	 */
+	char const * begin() const {
+		return static_cast<char const *>(this->addr);
+	}
+
+	/**
+	 * Returns a pointer behind the last character of the file.
+	 *
+	 * @return
+	 *	A pointer to the end of the file contents
+	 */
+	char const * end() const {
+		return begin() + this->len;
+	}
+
+	/**
+	 * Returns the number of mapped characters.
+	 *
+	 * @return
+	 *	The size of the file
+	 */
+	std::size_t size() const {
+		return this->len;
+	}
+};
+
 /**
  * Produces file access types around the C file handling facilities.
  *
@@ -340,6 +489,26 @@ class file_feature {
 	bool error() const {
 		return this->handle && ferror(this->handle);
 	}
+
+	/**
+	 * Set the size of the file buffer.
+	 *
+	 * The buffer is allocated by the FILE object, I/O is fully
+	 * buffered. This must be called before any other operation
+	 * on the file.
+	 *
+	 * @see setvbuf()
+	 * @param size
+	 *	The buffer size in characters
+	 * @return
+	 *	A self reference
+	 */
+	FileT & buffer(std::size_t const size) {
+		if (this->handle) {
+			setvbuf(this->handle, nullptr, _IOFBF, size);
+		}
+		return *this;
+	}
 };
 
 /**
@@ -460,6 +629,32 @@ class file_feature<FileT, read, Tail ...> :
 	bool gets(char (& dst)[Count]) {
 		return this->handle && fgets(dst, Count, this->handle);
 	}
+
+	/**
+	 * Read a line of arbitrary length from the file.
+	 *
+	 * Reads the file up to and including the first newline. The
+	 * destination buffer is allocated or grown as required and
+	 * must be released with free(). Always zero terminated.
+	 *
+	 * @see getline()
+	 * @param dst
+	 *	A reference to the destination buffer pointer, may
+	 *	refer to a nullptr
+	 * @param capacity
+	 *	A reference to the size of the destination buffer
+	 * @return
+	 *	The number of characters read, not counting the
+	 *	terminating zero
+	 * @retval -1
+	 *	No characters could be read
+	 */
+	ssize_t getline(char *& dst, std::size_t & capacity) {
+		if (this->handle) {
+			return ::getline(&dst, &capacity, this->handle);
+		}
+		return -1;
+	}
 };
 
 /**
@@ -473,9 +668,136 @@ class file_feature<FileT, read, Tail ...> :
 template <class FileT, feature ... Tail>
 class file_feature<FileT, write, Tail ...> :
     public file_feature<FileT, Tail ...> {
+	private:
+	/**
+	 * The size of the put() formatting buffer.
+	 */
+	static constexpr std::size_t const PUTBUF{256};
+
+	/**
+	 * The maximum number of characters a formatted number takes.
+	 */
+	static constexpr std::size_t const DIGITS{48};
+
+	/**
+	 * Ensure the put() formatting buffer has room for the given
+	 * number of characters, write the buffer to the file if not.
+	 *
+	 * @param buf,it
+	 *	The buffer and the current write position
+	 * @param count
+	 *	The number of characters to make room for
+	 */
+	void reserve(char (& buf)[PUTBUF], char *& it, std::size_t const count) {
+		if (static_cast<std::size_t>(buf + PUTBUF - it) < count) {
+			fwrite(buf, 1, it - buf, this->handle);
+			it = buf;
+		}
+	}
+
+	/**
+	 * Format a value into the put() formatting buffer.
+	 *
+	 * @tparam T
+	 *	The value type, must be a character, an integral type
+	 *	or convertible to a C string
+	 * @param buf,it
+	 *	The buffer and the current write position
+	 * @param value
+	 *	The value to format
+	 */
+	template <typename T>
+	void format(char (& buf)[PUTBUF], char *& it, T const & value) {
+		if constexpr (std::is_same_v<T, char>) {
+			reserve(buf, it, 1);
+			*it++ = value;
+		} else if constexpr (std::is_integral_v<T> &&
+		                     !std::is_same_v<T, bool>) {
+			reserve(buf, it, DIGITS);
+			it = std::to_chars(it, buf + PUTBUF, value).ptr;
+		} else if constexpr (std::is_convertible_v<T const &, char const *>) {
+			char const * const str = value;
+			auto const len = strlen(str);
+			reserve(buf, it, len);
+			if (len > PUTBUF) {
+				fwrite(str, 1, len, this->handle);
+			} else {
+				memcpy(it, str, len);
+				it += len;
+			}
+		} else {
+			static_assert(!sizeof(T), "unsupported argument type");
+		}
+	}
+
+	/**
+	 * Format a fixed-point value into the put() formatting buffer.
+	 *
+	 * @tparam Decimals
+	 *	The number of decimal places
+	 * @param buf,it
+	 *	The buffer and the current write position
+	 * @param value
+	 *	The value to format
+	 */
+	template <unsigned Decimals>
+	void format(char (& buf)[PUTBUF], char *& it,
+	            fixed<Decimals> const & value) {
+		unsigned long long scale{1};
+		for (unsigned i = 0; i < Decimals; ++i) {
+			scale *= 10;
+		}
+		auto const scaled = std::llround(value.value * scale);
+		unsigned long long const abs = scaled < 0 ? -scaled : scaled;
+		reserve(buf, it, DIGITS);
+		if (scaled < 0) {
+			*it++ = '-';
+		}
+		it = std::to_chars(it, buf + PUTBUF, abs / scale).ptr;
+		if constexpr (Decimals > 0) {
+			*it++ = '.';
+			auto frac = abs % scale;
+			for (auto digit = it + Decimals; digit != it; frac /= 10) {
+				*--digit = '0' + frac % 10;
+			}
+			it += Decimals;
+		}
+	}
+
 	public:
 	using file_feature<FileT, Tail ...>::file_feature;
 
+	/**
+	 * Output a sequence of values without a format string.
+	 *
+	 * Integral values are formatted with std::to_chars(), fixed
+	 * values with the given number of decimal places, characters
+	 * and C strings are output verbatim. Unsupported argument
+	 * types are rejected at compile time.
+	 *
+	 * The values are collected in a local buffer and passed to
+	 * the file in large blocks. The file is not flushed, so
+	 * output is subject to the buffering policy of the file.
+	 *
+	 * @see buffer()
+	 * @tparam ArgTs
+	 *	The argument types of the data to output
+	 * @param args
+	 *	The set of data to output
+	 * @return
+	 *	A self reference
+	 */
+	template <typename ... ArgTs>
+	FileT & put(ArgTs const & ... args) {
+		if (this->handle) {
+			char buf[PUTBUF];
+			char * it = buf;
+			(this->format(buf, it, args), ...);
+			fwrite(buf, 1, it - buf, this->handle);
+		}
+		return *this;
+	}
+
 	/**
 	 * Output with printf style formatting.
 	 *
@@ -605,6 +927,27 @@ class file_feature<FileT, write, Tail ...> :
 		return *this;
 	}
 
+	/**
+	 * Write objects from a dynamically allocated buffer to file.
+	 *
+	 * @see fwrite()
+	 * @tparam T
+	 *	The object type, should be a POD type
+	 * @param src
+	 *	A pointer to the first object to write out to the file
+	 * @param count
+	 *	The number of objects to write
+	 * @return
+	 *	A self reference
+	 */
+	template <typename T>
+	FileT & write(T const * const src, std::size_t const count) {
+		if (this->handle && src) {
+			fwrite(src, sizeof(T), count, this->handle);
+		}
+		return *this;
+	}
+
 	/**
 	 * Flush file buffers.
 	 *
@@ -683,6 +1026,61 @@ class file_feature<FileT, seek, Tail ...> :
 	}
 };
 
+/**
+ * Implement memory mapping support for file types.
+ *
+ * @tparam FileT
+ *	The file access type inheriting the feature
+ * @tparam Tail
+ *	The remaining features
+ */
+template <class FileT, feature ... Tail>
+class file_feature<FileT, mmap, Tail ...> :
+    public file_feature<FileT, Tail ...> {
+	public:
+	using file_feature<FileT, Tail ...>::file_feature;
+
+	/**
+	 * Map the whole file into memory for reading.
+	 *
+	 * The mapping is independent of the current file position and
+	 * the stdio buffer, callers that already consumed input should
+	 * start reading at the offset returned by ftell().
+	 *
+	 * Sequential access is advised, so the kernel reads ahead
+	 * aggressively and drops pages behind the reader.
+	 *
+	 * Only non-empty regular files can be mapped, pipes, sockets
+	 * and terminals result in an empty mapping. Callers are
+	 * expected to fall back to streaming in that case.
+	 *
+	 * @see mmap(2)
+	 * @see madvise(2)
+	 * @return
+	 *	The mapping of the file contents, which is empty if
+	 *	the file cannot be mapped
+	 */
+	mapping map() const {
+		if (!this->handle) {
+			return {};
+		}
+		auto const fd = fileno(this->handle);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+		    st.st_size <= 0) {
+			return {};
+		}
+		auto const len = static_cast<std::size_t>(st.st_size);
+		auto const addr = ::mmap(nullptr, len, PROT_READ, MAP_SHARED,
+		                         fd, 0);
+		if (addr == MAP_FAILED) {
+			return {};
+		}
+		madvise(addr, len, MADV_SEQUENTIAL);
+		return {addr, len};
+	}
+};
+
 /**
  * Specialise for FILE object owning file instances.
  *
@@ -784,7 +1182,8 @@ class file<own, Features ...> final :
 	    file{(!filename || !mode ||
 	          (contains_v<set<Features ...>, write> &&
 		   !query{mode}.contains.any('w', '+')) ||
-		  (contains_v<set<Features ...>, read> &&
+		  ((contains_v<set<Features ...>, read> ||
+		    contains_v<set<Features ...>, mmap>) &&
 		   !query{mode}.contains.any('r', '+')) ||
 		  (contains_v<set<Features ...>, seek> &&
 		   query{mode}.contains('a') && !query{mode}.contains('+')))
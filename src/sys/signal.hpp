@@ -8,6 +8,7 @@
 #define _POWERDXX_SYS_SIGNAL_HPP_
 
 #include "error.hpp"    /* sys::sc_error */
+#include "event.hpp"    /* sys::event::Reactor */
 
 #include <csignal>
 
@@ -31,6 +32,9 @@ using sig_t = void (*)(int);
 /**
  * Sets up a given signal handler and restores the old handler when
  * going out of scope.
+ *
+ * Alternatively the signal can be delivered through an event reactor,
+ * which reports it synchronously from sys::event::Reactor::wait().
  */
 class Signal {
 	private:
@@ -44,6 +48,11 @@ class Signal {
 	 */
 	sig_t const handler;
 
+	/**
+	 * The reactor watching the signal, if any.
+	 */
+	event::Reactor * const reactor;
+
 	public:
 	/**
 	 * Sets up the given handler.
@@ -56,17 +65,42 @@ class Signal {
 	 *	Throws with the errno of signal()
 	 */
 	Signal(int const sig, sig_t const handler) :
-	    sig{sig}, handler{::signal(sig, handler)} {
+	    sig{sig}, handler{::signal(sig, handler)}, reactor{nullptr} {
 		if (this->handler == SIG_ERR) {
 			throw sc_error<error>{errno};
 		}
 	}
 
+	/**
+	 * Delivers the signal through the given reactor.
+	 *
+	 * @param sig
+	 *	The signal to watch
+	 * @param reactor
+	 *	The reactor to report the signal, must outlive this
+	 *	instance
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of signal()
+	 * @throws sys::sc_error<event::error>
+	 *	Throws if the reactor fails to watch the signal
+	 */
+	Signal(int const sig, event::Reactor & reactor) :
+	    sig{sig}, handler{reactor.signal(sig)}, reactor{&reactor} {
+		if (this->handler == SIG_ERR) {
+			auto const err = errno;
+			reactor.unsignal(sig);
+			throw sc_error<error>{err};
+		}
+	}
+
 	/**
 	 * Restore previous signal handler.
 	 */
 	~Signal() {
 		::signal(this->sig, this->handler);
+		if (this->reactor) {
+			this->reactor->unsignal(this->sig);
+		}
 	}
 };
 
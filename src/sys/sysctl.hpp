@@ -8,6 +8,7 @@
 #define _POWERDXX_SYS_SYSCTL_HPP_
 
 #include "error.hpp"       /* sys::sc_error */
+#include "ctl.hpp"         /* sys::ctl::Sync, sys::ctl::Once */
 
 #include <memory>          /* std::unique_ptr */
 
@@ -18,24 +19,8 @@
 
 namespace sys {
 
-/**
- * This namespace contains safer c++ wrappers for the sysctl() interface.
- *
- * The template class Sysctl represents a sysctl address and offers
- * handles to retrieve or set the stored value.
- *
- * The template class Sync represents a sysctl value that is read and
- * written synchronously.
- *
- * The template class Once represents a read once value.
- */
 namespace ctl {
 
-/**
- * The domain error type.
- */
-struct error {};
-
 /**
  * Management Information Base identifier type (see sysctl(3)).
  */
@@ -365,78 +350,6 @@ Sysctl(char const * const) -> Sysctl<0>;
  */
 Sysctl() -> Sysctl<0>;
 
-/**
- * This is a wrapper around Sysctl that allows semantically transparent
- * use of a sysctl.
- *
- * ~~~ c++
- * Sync<int, Sysctl<0>> sndUnit{{"hw.snd.default_unit"}};
- * if (sndUnit != 3) {    // read from sysctl
- *	sndUnit = 3;      // assign to sysctl
- * }
- * ~~~
- *
- * Note that both assignment and read access (implemented through
- * type casting to T) may throw an exception.
- *
- * @tparam T
- *	The type to represent the sysctl as
- * @tparam SysctlT
- *	The Sysctl type
- */
-template <typename T, class SysctlT>
-class Sync {
-	private:
-	/**
-	 * A sysctl to represent.
-	 */
-	SysctlT sysctl;
-
-	public:
-	/**
-	 * The default constructor.
-	 *
-	 * This is available to defer initialisation to a later moment.
-	 * This might be useful when initialising global or static
-	 * instances by a character string repesented name.
-	 */
-	constexpr Sync() {}
-
-	/**
-	 * The constructor copies the given Sysctl instance.
-	 *
-	 * @param sysctl
-	 *	The Sysctl instance to represent
-	 */
-	constexpr Sync(SysctlT const & sysctl) noexcept : sysctl{sysctl} {}
-
-	/**
-	 * Transparently assiges values of type T to the represented
-	 * Sysctl instance.
-	 *
-	 * @param value
-	 *	The value to assign
-	 * @return
-	 *	A self reference
-	 */
-	Sync & operator =(T const & value) {
-		this->sysctl.set(value);
-		return *this;
-	}
-
-	/**
-	 * Implicitly cast to the represented type.
-	 *
-	 * @return
-	 *	Returns the value from the sysctl
-	 */
-	operator T () const {
-		T value;
-		this->sysctl.get(value);
-		return value;
-	}
-};
-
 /**
  * A convenience alias around Sync.
  *
@@ -456,73 +369,6 @@ class Sync {
 template <typename T, size_t MibDepth = 0>
 using SysctlSync = Sync<T, Sysctl<MibDepth>>;
 
-/**
- * A read once representation of a Sysctl.
- *
- * This reads a sysctl once upon construction and always returns that
- * value. It does not support assignment.
- *
- * This class is intended for sysctls that are not expected to change,
- * such as hw.ncpu. A special property of this class is that the
- * constructor does not throw and takes a default value in case reading
- * the sysctl fails.
- *
- * ~~~ c++
- * // Read number of CPU cores, assume 1 on failure:
- * Once<coreid_t, Sysctl<2>> ncpu{1, {CTL_HW, HW_NCPU}};
- * // Equivalent:
- * int hw_ncpu;
- * try {
- * 	Sysctl<2>{CTL_HW, HW_NCPU}.get(hw_ncpu);
- * } catch (sys::sc_error<error>) {
- * 	hw_ncpu = 1;
- * }
- * ~~~
- *
- * @tparam T
- *	The type to represent the sysctl as
- * @tparam SysctlT
- *	The Sysctl type
- */
-template <typename T, class SysctlT>
-class Once {
-	private:
-	/**
-	 * The sysctl value read upon construction.
-	 */
-	T value;
-
-	public:
-	/**
-	 * The constructor tries to read and store the requested sysctl.
-	 *
-	 * If reading the requested sysctl fails for any reason,
-	 * the given value is stored instead.
-	 *
-	 * @param value
-	 *	The fallback value
-	 * @param sysctl
-	 *	The sysctl to represent
-	 */
-	Once(T const & value, SysctlT const & sysctl) noexcept {
-		try {
-			sysctl.get(this->value);
-		} catch (sc_error<error>) {
-			this->value = value;
-		}
-	}
-
-	/**
-	 * Return a const reference to the value.
-	 *
-	 * @return
-	 *	A const reference to the value
-	 */
-	operator T const &() const {
-		return this->value;
-	}
-};
-
 /**
  * A convenience alias around Once.
  *
@@ -0,0 +1,733 @@
+/**
+ * Implements a procfs and sysfs backend for the sys::ctl wrappers.
+ *
+ * @file
+ */
+
+#ifndef _POWERDXX_SYS_SYSFS_HPP_
+#define _POWERDXX_SYS_SYSFS_HPP_
+
+#include "error.hpp"       /* sys::sc_error */
+#include "ctl.hpp"         /* sys::ctl::Sync, sys::ctl::Once */
+
+#include <memory>          /* std::shared_ptr, std::unique_ptr */
+#include <string>          /* std::string */
+#include <vector>          /* std::vector */
+#include <iterator>        /* std::size() */
+#include <type_traits>     /* std::is_arithmetic */
+#include <charconv>        /* std::from_chars() */
+#include <cstring>         /* memcpy() */
+#include <cstdio>          /* sscanf() */
+
+#include <fcntl.h>         /* open() */
+#include <unistd.h>        /* pread(), pwrite(), close() */
+
+namespace sys {
+namespace ctl {
+
+/**
+ * Parses the per CPU tick counters from /proc/stat.
+ *
+ * The file is read with pread() into a buffer that is reused by all
+ * calls, the buffer grows to fit the input once. The counters are
+ * decoded in place, only the cpuN rows are parsed, parsing stops at
+ * the first row behind them.
+ *
+ * The Linux CPU states are mapped onto the FreeBSD CP_* states:
+ *
+ * | Linux          | FreeBSD |
+ * |----------------|---------|
+ * | user           | CP_USER |
+ * | nice           | CP_NICE |
+ * | system         | CP_SYS  |
+ * | irq, softirq   | CP_INTR |
+ * | idle, iowait   | CP_IDLE |
+ *
+ * The steal and guest times are ignored, guest time is already
+ * accounted as user time.
+ */
+class ProcStat {
+	public:
+	/**
+	 * The CPU states in the order of the CP_* constants.
+	 */
+	enum cpustate : size_t {
+		USER, NICE, SYS, INTR, IDLE,
+		STATES /**< The number of CPU states */
+	};
+
+#ifdef CPUSTATES
+	static_assert(STATES == CPUSTATES && USER == CP_USER &&
+	              NICE == CP_NICE && SYS == CP_SYS &&
+	              INTR == CP_INTR && IDLE == CP_IDLE,
+	              "CPU states must match the CP_* constants");
+#endif
+
+	private:
+	/**
+	 * The file descriptor of /proc/stat.
+	 */
+	int fd;
+
+	/**
+	 * The reusable input buffer.
+	 */
+	std::vector<char> buf;
+
+	/**
+	 * The number of CPUs in the last input.
+	 */
+	size_t ncpu{0};
+
+	/**
+	 * Read the input into the buffer.
+	 *
+	 * The input is assumed to be complete when a read does not
+	 * fill the buffer.
+	 *
+	 * @return
+	 *	The number of characters read
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread()
+	 */
+	size_t fill() {
+		size_t len{0};
+		while (true) {
+			auto const count = pread(this->fd, &this->buf[len],
+			                         this->buf.size() - len, len);
+			if (count == -1) {
+				throw sc_error<error>{errno};
+			}
+			len += count;
+			if (len < this->buf.size()) {
+				return len;
+			}
+			this->buf.resize(this->buf.size() * 2);
+		}
+	}
+
+	/**
+	 * Parse an unsigned decimal number.
+	 *
+	 * @param it,end
+	 *	The character range to parse from, leading blanks are
+	 *	skipped, it is set behind the number
+	 * @param value
+	 *	Set to the parsed value
+	 * @retval true
+	 *	A number was parsed
+	 * @retval false
+	 *	No number was found
+	 */
+	template <typename T>
+	static bool parse(char const *& it, char const * const end,
+	                  T & value) {
+		for (; it != end && *it == ' '; ++it);
+		auto const first = it;
+		value = 0;
+		for (; it != end && *it >= '0' && *it <= '9'; ++it) {
+			value = value * 10 + (*it - '0');
+		}
+		return it != first;
+	}
+
+	public:
+	/**
+	 * Open /proc/stat.
+	 *
+	 * @param path
+	 *	The path to /proc/stat
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of open()
+	 */
+	explicit ProcStat(char const * const path = "/proc/stat") :
+	    fd{::open(path, O_RDONLY | O_CLOEXEC)}, buf(16384) {
+		if (this->fd == -1) {
+			throw sc_error<error>{errno};
+		}
+	}
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 */
+	ProcStat(ProcStat const &) = delete;
+
+	/**
+	 * Must not copy the file descriptor ownership.
+	 *
+	 * @return
+	 *	A self reference
+	 */
+	ProcStat & operator =(ProcStat const &) = delete;
+
+	/**
+	 * Close /proc/stat.
+	 */
+	~ProcStat() {
+		::close(this->fd);
+	}
+
+	/**
+	 * Returns the number of CPUs in the last input.
+	 *
+	 * @return
+	 *	The number of CPUs, 0 before the first read
+	 */
+	size_t cpus() const {
+		return this->ncpu;
+	}
+
+	/**
+	 * Read the tick counters of all CPUs.
+	 *
+	 * CPUs missing from the input, e.g. because they are offline,
+	 * are set to 0.
+	 *
+	 * @tparam T
+	 *	The tick counter type
+	 * @tparam States
+	 *	The number of states per CPU, must be STATES
+	 * @param dst,count
+	 *	The destination array and its number of CPUs, rows of
+	 *	CPUs beyond count are skipped
+	 * @return
+	 *	The number of CPUs in the input, i.e. the highest CPU
+	 *	number + 1
+	 * @throws sys::sc_error<error>
+	 *	Throws if reading the input fails
+	 */
+	template <typename T, size_t States>
+	size_t operator ()(T (* const dst)[States], size_t const count) {
+		static_assert(States == STATES, "unexpected number of CPU states");
+		/* user nice system idle iowait irq softirq */
+		static constexpr cpustate const MAP[]{
+			USER, NICE, SYS, IDLE, IDLE, INTR, INTR
+		};
+		for (size_t i = 0; i < count; ++i) {
+			for (auto & ticks : dst[i]) {
+				ticks = 0;
+			}
+		}
+		char const * it = this->buf.data();
+		char const * const end = it + fill();
+		size_t cpus{0};
+		/* skip the aggregate cpu row */
+		it = static_cast<char const *>(std::memchr(it, '\n', end - it));
+		while (it && ++it != end && end - it > 3 &&
+		       it[0] == 'c' && it[1] == 'p' && it[2] == 'u') {
+			it += 3;
+			size_t cpu{0};
+			if (!parse(it, end, cpu)) {
+				break;
+			}
+			cpus = cpu >= cpus ? cpu + 1 : cpus;
+			for (size_t i = 0; cpu < count && i < std::size(MAP); ++i) {
+				T ticks{0};
+				if (!parse(it, end, ticks)) {
+					break;
+				}
+				dst[cpu][MAP[i]] += ticks;
+			}
+			it = static_cast<char const *>(std::memchr(it, '\n', end - it));
+		}
+		return this->ncpu = cpus;
+	}
+};
+
+/**
+ * Represents a procfs or sysfs node by the name of the equivalent
+ * sysctl.
+ *
+ * This offers the interface of Sysctl<0>, so it can be used with
+ * Sync and Once. The supported names are:
+ *
+ * | Name                       | Node                                      |
+ * |----------------------------|-------------------------------------------|
+ * | kern.cp_times              | /proc/stat                                |
+ * | hw.ncpu                    | /sys/devices/system/cpu/present           |
+ * | dev.cpu.%d.freq            | scaling_cur_freq, scaling_setspeed        |
+ * | dev.cpu.%d.freq_levels     | scaling_available_frequencies             |
+ * | dev.cpu.%d.freq_min        | scaling_min_freq                          |
+ * | dev.cpu.%d.freq_max        | scaling_max_freq                          |
+ * | dev.cpufreq.%d.freq_driver | scaling_driver                            |
+ *
+ * The scaling_* nodes are located in
+ * /sys/devices/system/cpu/cpu%d/cpufreq/.
+ * Like on FreeBSD, dev.cpu.%d.freq only exists for the first core
+ * of every clock domain, i.e. the first core listed in
+ * cpufreq/related_cpus. Frequencies are converted from kHz to MHz.
+ *
+ * Values are presented in the format of the equivalent sysctl, i.e.
+ * frequencies are int, kern.cp_times is an array of long in the
+ * order of the CP_* constants and dev.cpu.%d.freq_levels is a
+ * character string of `freq/power` pairs with an unknown power of
+ * -1.
+ *
+ * The nodes are opened once and read with pread(), so repeated
+ * access does not reopen files. Copies share the file descriptors.
+ *
+ * All paths are prefixed with a configurable root directory, so
+ * the backend can be run against a fake tree.
+ *
+ * Note that writing dev.cpu.%d.freq requires the userspace cpufreq
+ * governor.
+ */
+class Sysfs {
+	private:
+	/**
+	 * How node contents are presented.
+	 */
+	enum class format {
+		number,   /**< An integer, divided by the scale */
+		text,     /**< A character string */
+		levels,   /**< A list of frequencies */
+		cp_times, /**< CPU tick counters from /proc/stat */
+		count,    /**< A CPU list presented as the number of CPUs */
+	};
+
+	/**
+	 * An open file descriptor, closed with the last reference.
+	 */
+	struct descriptor {
+		/**
+		 * The file descriptor.
+		 */
+		int const fd;
+
+		/**
+		 * Close the file descriptor.
+		 */
+		~descriptor() {
+			::close(this->fd);
+		}
+	};
+
+	/**
+	 * The node to read from.
+	 */
+	std::shared_ptr<descriptor const> in;
+
+	/**
+	 * The node to write to, may be the same as the node to read.
+	 */
+	std::shared_ptr<descriptor const> out;
+
+	/**
+	 * The /proc/stat parser for kern.cp_times.
+	 */
+	std::shared_ptr<ProcStat> stat;
+
+	/**
+	 * The presentation of the node contents.
+	 */
+	format fmt{format::number};
+
+	/**
+	 * The divisor to apply to read numbers, the factor for written
+	 * numbers.
+	 */
+	long scale{1};
+
+	/**
+	 * The root directory to prefix all paths with.
+	 *
+	 * @return
+	 *	A reference to the root directory
+	 */
+	static std::string & prefix() {
+		static std::string prefix{};
+		return prefix;
+	}
+
+	/**
+	 * Open a node.
+	 *
+	 * @param path
+	 *	The absolute path of the node below the root directory
+	 * @param flags
+	 *	The open() flags
+	 * @return
+	 *	The shared file descriptor
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of open()
+	 */
+	static std::shared_ptr<descriptor const>
+	open(std::string const & path, int const flags) {
+		auto const fd = ::open((prefix() + path).c_str(),
+		                       flags | O_CLOEXEC);
+		if (fd == -1) {
+			throw sc_error<error>{errno};
+		}
+		return std::shared_ptr<descriptor const>{new descriptor{fd}};
+	}
+
+	/**
+	 * Read the complete contents of a node.
+	 *
+	 * @param node
+	 *	The node to read
+	 * @return
+	 *	The node contents
+	 * @throws sys::sc_error<error>
+	 *	Throws with the errno of pread(), or EBADF for an
+	 *	uninitialised instance
+	 */
+	static std::string read(std::shared_ptr<descriptor const> const & node) {
+		if (!node) {
+			throw sc_error<error>{EBADF};
+		}
+		std::string result(4096, 0);
+		size_t len{0};
+		while (true) {
+			auto const count = pread(node->fd, &result[len],
+			                         result.size() - len, len);
+			if (count == -1) {
+				throw sc_error<error>{errno};
+			}
+			if (count == 0) {
+				break;
+			}
+			len += count;
+			if (len == result.size()) {
+				result.resize(result.size() * 2);
+			}
+		}
+		result.resize(len);
+		return result;
+	}
+
+	/**
+	 * Parse an integer.
+	 *
+	 * @param it,end
+	 *	The character range to parse from, leading whitespace
+	 *	is skipped, it is set behind the integer
+	 * @param value
+	 *	The destination of the integer
+	 * @retval true
+	 *	An integer was parsed
+	 * @retval false
+	 *	No integer was found
+	 */
+	static bool parse(char const *& it, char const * const end,
+	                  long & value) {
+		for (; it != end && (*it == ' ' || *it == '\t' || *it == '\n');
+		     ++it);
+		auto const result = std::from_chars(it, end, value);
+		if (result.ec != std::errc{}) {
+			return false;
+		}
+		it = result.ptr;
+		return true;
+	}
+
+	/**
+	 * Returns the first CPU of the clock domain the given CPU
+	 * belongs to.
+	 *
+	 * @param dir
+	 *	The cpufreq directory of the CPU
+	 * @return
+	 *	The first CPU in cpufreq/related_cpus
+	 * @throws sys::sc_error<error>
+	 *	Throws if the node cannot be read
+	 */
+	static long leader(std::string const & dir) {
+		auto const cpus = read(open(dir + "related_cpus", O_RDONLY));
+		char const * it = cpus.data();
+		long cpu{-1};
+		if (!parse(it, it + cpus.size(), cpu)) {
+			throw sc_error<error>{EINVAL};
+		}
+		return cpu;
+	}
+
+	/**
+	 * Returns the contents of the node, presented like the
+	 * equivalent sysctl.
+	 *
+	 * @return
+	 *	The sysctl value bytes
+	 * @throws sys::sc_error<error>
+	 *	Throws if the node cannot be read or parsed
+	 */
+	std::string present() const {
+		if (this->fmt == format::cp_times) {
+			using row_t = long[ProcStat::STATES];
+			std::vector<long> times{};
+			/* only read twice if the number of CPUs grew */
+			size_t cpus{this->stat->cpus()};
+			do {
+				times.resize(cpus * ProcStat::STATES);
+				cpus = (*this->stat)(reinterpret_cast<row_t *>(times.data()),
+				                     cpus);
+			} while (cpus * ProcStat::STATES > times.size());
+			times.resize(cpus * ProcStat::STATES);
+			return {reinterpret_cast<char const *>(times.data()),
+			        times.size() * sizeof(long)};
+		}
+		auto const text = read(this->in);
+		char const * it = text.data();
+		char const * const end = it + text.size();
+		std::string result{};
+		switch (this->fmt) {
+		case format::number: {
+			long number{0};
+			if (!parse(it, end, number)) {
+				throw sc_error<error>{EINVAL};
+			}
+			int const value = number / this->scale;
+			result.assign(reinterpret_cast<char const *>(&value),
+			              sizeof(value));
+			break;
+		}
+		case format::text:
+			result.assign(it, end);
+			while (!result.empty() && result.back() == '\n') {
+				result.pop_back();
+			}
+			result.push_back(0);
+			break;
+		case format::levels:
+			for (long freq{0}; parse(it, end, freq);) {
+				result += std::to_string(freq / this->scale);
+				result += "/-1 ";
+			}
+			if (!result.empty()) {
+				result.back() = 0;
+			} else {
+				result.push_back(0);
+			}
+			break;
+		case format::cp_times:
+			/* handled by ProcStat */
+			break;
+		case format::count: {
+			long cpu{-1};
+			for (; it != end && parse(it, end, cpu); ++it);
+			if (cpu < 0) {
+				throw sc_error<error>{EINVAL};
+			}
+			int const count = cpu + 1;
+			result.assign(reinterpret_cast<char const *>(&count),
+			              sizeof(count));
+			break;
+		}
+		}
+		return result;
+	}
+
+	public:
+	/**
+	 * Set the root directory to prefix all paths with.
+	 *
+	 * This only affects instances constructed afterwards.
+	 *
+	 * @param dir
+	 *	The root directory, empty for the real root
+	 */
+	static void root(std::string const & dir) {
+		prefix() = dir;
+	}
+
+	/**
+	 * Returns the root directory all paths are prefixed with.
+	 *
+	 * @return
+	 *	The root directory
+	 */
+	static std::string const & root() {
+		return prefix();
+	}
+
+	/**
+	 * The default constructor.
+	 *
+	 * This is available to defer initialisation to a later moment.
+	 */
+	Sysfs() {}
+
+	/**
+	 * Open the node for the given sysctl name.
+	 *
+	 * @param name
+	 *	The symbolic name of the sysctl
+	 * @throws sys::sc_error<error>
+	 *	Throws ENOENT for unsupported names or if opening a node
+	 *	fails
+	 */
+	Sysfs(char const * const name) {
+		int cpu{-1};
+		int end{0};
+		char attr[32]{};
+		if (std::strcmp(name, "kern.cp_times") == 0) {
+			this->stat = std::make_shared<ProcStat>(
+			    (prefix() + "/proc/stat").c_str());
+			this->fmt = format::cp_times;
+			return;
+		}
+		if (std::strcmp(name, "hw.ncpu") == 0) {
+			this->in = open("/sys/devices/system/cpu/present", O_RDONLY);
+			this->fmt = format::count;
+			return;
+		}
+		auto const dir = [](int const cpu) {
+			return "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+			       "/cpufreq/";
+		};
+		if (std::sscanf(name, "dev.cpufreq.%d.%31s%n", &cpu, attr,
+		                &end) == 2 && !name[end] &&
+		    std::strcmp(attr, "freq_driver") == 0) {
+			this->in = open(dir(cpu) + "scaling_driver", O_RDONLY);
+			this->fmt = format::text;
+			return;
+		}
+		if (std::sscanf(name, "dev.cpu.%d.%31s%n", &cpu, attr,
+		                &end) != 2 || name[end] || cpu < 0) {
+			throw sc_error<error>{ENOENT};
+		}
+		if (std::strcmp(attr, "freq") == 0) {
+			if (leader(dir(cpu)) != cpu) {
+				throw sc_error<error>{ENOENT};
+			}
+			this->in = open(dir(cpu) + "scaling_cur_freq", O_RDONLY);
+			try {
+				this->out = open(dir(cpu) + "scaling_setspeed",
+				                 O_WRONLY);
+			} catch (sc_error<error>) {
+				/* read-only without the userspace governor */
+			}
+			this->scale = 1000;
+		} else if (std::strcmp(attr, "freq_levels") == 0) {
+			this->in = open(dir(cpu) + "scaling_available_frequencies",
+			                O_RDONLY);
+			this->fmt = format::levels;
+			this->scale = 1000;
+		} else if (std::strcmp(attr, "freq_min") == 0 ||
+		           std::strcmp(attr, "freq_max") == 0) {
+			this->in = this->out =
+			    open(dir(cpu) + "scaling_" + (attr + 5) + "_freq",
+			         O_RDWR);
+			this->scale = 1000;
+		} else {
+			throw sc_error<error>{ENOENT};
+		}
+	}
+
+	/**
+	 * @copydoc Sysctl::size() const
+	 */
+	size_t size() const {
+		return present().size();
+	}
+
+	/**
+	 * @copydoc Sysctl::get(void * const, size_t const) const
+	 */
+	void get(void * const buf, size_t const bufsize) const {
+		auto const bytes = present();
+		if (bytes.size() > bufsize) {
+			throw sc_error<error>{ENOMEM};
+		}
+		std::memcpy(buf, bytes.data(), bytes.size());
+	}
+
+	/**
+	 * @copydoc Sysctl::get(T &) const
+	 */
+	template <typename T>
+	void get(T & value) const {
+		if constexpr (std::is_arithmetic_v<T>) {
+			if (this->fmt == format::number) {
+				auto const text = read(this->in);
+				char const * it = text.data();
+				long number{0};
+				if (!parse(it, it + text.size(), number)) {
+					throw sc_error<error>{EINVAL};
+				}
+				value = static_cast<T>(number / this->scale);
+				return;
+			}
+		}
+		get(&value, sizeof(T));
+	}
+
+	/**
+	 * @copydoc Sysctl::get() const
+	 */
+	template <typename T>
+	std::unique_ptr<T[]> get() const {
+		auto const bytes = present();
+		auto result = std::unique_ptr<T[]>(new T[bytes.size() / sizeof(T)]);
+		std::memcpy(result.get(), bytes.data(),
+		            bytes.size() / sizeof(T) * sizeof(T));
+		return result;
+	}
+
+	/**
+	 * @copydoc Sysctl::set(void const * const, size_t const)
+	 */
+	void set(void const * const buf, size_t const bufsize) {
+		if (this->fmt != format::number || bufsize != sizeof(int)) {
+			throw sc_error<error>{EINVAL};
+		}
+		int value{0};
+		std::memcpy(&value, buf, sizeof(value));
+		set(value);
+	}
+
+	/**
+	 * @copydoc Sysctl::set(T const &)
+	 */
+	template <typename T>
+	void set(T const & value) {
+		if constexpr (!std::is_arithmetic_v<T>) {
+			set(&value, sizeof(T));
+		} else {
+			if (!this->out || this->fmt != format::number) {
+				throw sc_error<error>{EPERM};
+			}
+			auto const text =
+			    std::to_string(static_cast<long>(value) * this->scale);
+			if (pwrite(this->out->fd, text.data(), text.size(), 0) !=
+			    static_cast<ssize_t>(text.size())) {
+				throw sc_error<error>{errno};
+			}
+			if (ftruncate(this->out->fd, text.size()) == -1) {
+				/* sysfs nodes cannot be truncated, regular
+				 * files in a fake tree can */
+			}
+		}
+	}
+};
+
+/**
+ * A convenience alias around Sync.
+ *
+ * ~~~ c++
+ * SysfsSync<mhz_t> freq{{"dev.cpu.0.freq"}};
+ * ~~~
+ *
+ * @tparam T
+ *	The type to represent the node as
+ */
+template <typename T>
+using SysfsSync = Sync<T, Sysfs>;
+
+/**
+ * A convenience alias around Once.
+ *
+ * ~~~ c++
+ * SysfsOnce<coreid_t> ncpu{1, {"hw.ncpu"}};
+ * ~~~
+ *
+ * @tparam T
+ *	The type to represent the node as
+ */
+template <typename T>
+using SysfsOnce = Once<T, Sysfs>;
+
+} /* namespace ctl */
+} /* namespace sys */
+
+#endif /* _POWERDXX_SYS_SYSFS_HPP_ */
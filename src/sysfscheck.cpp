@@ -0,0 +1,234 @@
+/**
+ * Implements sysfscheck, a tool to inspect the procfs/sysfs backend.
+ *
+ * @file
+ */
+
+#include "Options.hpp"
+
+#include "errors.hpp"
+#include "utility.hpp"
+#include "clas.hpp"
+
+#include "sys/io.hpp"
+#include "sys/sysfs.hpp"
+
+#include <chrono>    /* std::chrono::steady_clock */
+#include <string>    /* std::string */
+#include <cstring>   /* strchr(), strcmp(), strlen() */
+#include <cstdlib>   /* strtol() */
+
+/**
+ * File local scope.
+ */
+namespace {
+
+using nih::Parameter;
+using nih::Options;
+
+using errors::Exit;
+using errors::Exception;
+using errors::fail;
+
+namespace io = sys::io;
+
+using sys::ctl::Sysfs;
+using sys::ctl::SysfsSync;
+
+using utility::to_value;
+using clas::count;
+using namespace utility::literals;
+
+using namespace std::literals::string_literals;
+
+/**
+ * An enum for command line parsing.
+ */
+enum class OE {
+	USAGE,              /**< Print help */
+	FILE_ROOT,          /**< Set the root directory */
+	CNT_BENCH,          /**< Set the number of timed reads */
+	NODE,               /**< A node to read or write */
+	OPT_NOOPT = NODE,   /**< Obligatory */
+	OPT_UNKNOWN,        /**< Obligatory */
+	OPT_DASH,           /**< Obligatory */
+	OPT_LDASH,          /**< Obligatory */
+	OPT_DONE            /**< Obligatory */
+};
+
+/**
+ * The short usage string.
+ */
+char const * const USAGE = "[-h] [-r dir] [-b cnt] name[=value] [...]";
+
+/**
+ * Definitions of command line parameters.
+ */
+Parameter<OE> const PARAMETERS[]{
+	{OE::USAGE,     'h', "help",  "",                   "Show usage and exit"},
+	{OE::FILE_ROOT, 'r', "root",  "dir",                "The root of the procfs/sysfs tree"},
+	{OE::CNT_BENCH, 'b', "bench", "cnt",                "Time cnt reads of the following sysctls"},
+	{OE::NODE,       0 , "",      "name[=value],[...]", "Read or write the given sysctl"},
+};
+
+/**
+ * The maximum number of timed reads.
+ */
+size_t const BENCH_MAX{1000000};
+
+/**
+ * The number of timed reads per sysctl, 0 to not time reads.
+ */
+size_t bench{0};
+
+/**
+ * Check whether a string ends with the given suffix.
+ *
+ * @param str,suffix
+ *	The string and suffix to compare
+ * @return
+ *	Whether str ends with suffix
+ */
+bool ends(char const * const str, char const * const suffix) {
+	auto const len = std::strlen(str);
+	auto const slen = std::strlen(suffix);
+	return len >= slen && std::strcmp(str + len - slen, suffix) == 0;
+}
+
+/**
+ * Print a sysctl in the format of a load recording header line.
+ *
+ * If the sysctl cannot be read, the error is printed instead.
+ *
+ * @param name
+ *	The sysctl name
+ */
+void print(char const * const name) try {
+	Sysfs const ctl{name};
+	std::string line{name};
+	line += '=';
+	if (std::strcmp(name, "kern.cp_times") == 0) {
+		auto const columns = ctl.size() / sizeof(long);
+		auto const times = ctl.get<long>();
+		for (size_t i = 0; i < columns; ++i) {
+			line += (i ? " " : "") + std::to_string(times[i]);
+		}
+	} else if (ends(name, ".freq_levels") || ends(name, ".freq_driver")) {
+		line += ctl.get<char>().get();
+	} else {
+		line += std::to_string(int{SysfsSync<int>{ctl}});
+	}
+	io::fout.printf("%s\n", line.c_str());
+
+	if (!bench) {
+		return;
+	}
+	auto const start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < bench; ++i) {
+		ctl.size();
+	}
+	std::chrono::duration<double, std::micro> const time{
+	    std::chrono::steady_clock::now() - start};
+	io::ferr.printf("%s: %zu reads, %.1f us per read\n",
+	                name, bench, time.count() / bench);
+} catch (sys::sc_error<sys::ctl::error> e) {
+	io::fout.printf("%s: %s\n", name, e.c_str());
+}
+
+/**
+ * Write and print a sysctl.
+ *
+ * @param arg
+ *	The argument in the format `name=value`
+ * @throws errors::Exception{Exit::ECLARG}
+ *	If the value is not an integer
+ */
+void write(char const * const arg) {
+	auto const eq = std::strchr(arg, '=');
+	std::string const name{arg, eq};
+	char * end{nullptr};
+	auto const value = std::strtol(eq + 1, &end, 10);
+	if (!eq[1] || *end) {
+		fail(Exit::ECLARG, 0, "integer value expected: "s + arg);
+	}
+	try {
+		SysfsSync<int>{Sysfs{name.c_str()}} = value;
+	} catch (sys::sc_error<sys::ctl::error> e) {
+		io::fout.printf("%s: %s\n", name.c_str(), e.c_str());
+		return;
+	}
+	print(name.c_str());
+}
+
+} /* namespace */
+
+/**
+ * Parse command line arguments and access the given sysctls.
+ *
+ * Sysctls are read or written in the order of the arguments. Failing
+ * accesses are reported on stdout, so the output of a fake tree can
+ * be compared to an expected output.
+ *
+ * @param argc,argv
+ *	The command line arguments
+ * @return
+ *	An exit code
+ * @see Exit
+ */
+int main(int argc, char * argv[]) try {
+	auto getopt = Options{argc, argv, USAGE, PARAMETERS};
+
+	try {
+		while (true) switch (getopt()) {
+		case OE::USAGE:
+			io::ferr.printf("%s", getopt.usage().c_str());
+			throw Exception{Exit::OK, 0, ""};
+		case OE::FILE_ROOT:
+			Sysfs::root(getopt[1]);
+			break;
+		case OE::CNT_BENCH:
+			bench = count(getopt[1], BENCH_MAX);
+			break;
+		case OE::NODE:
+			if (std::strchr(getopt[0], '=')) {
+				write(getopt[0]);
+			} else {
+				print(getopt[0]);
+			}
+			break;
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+			fail(Exit::ECLARG, 0,
+			     "unexpected command line argument: "s + getopt[0]);
+			break;
+		case OE::OPT_DONE:
+			return to_value(Exit::OK);
+		}
+	} catch (Exception & e) {
+		switch (getopt) {
+		case OE::USAGE:
+			break;
+		case OE::FILE_ROOT:
+		case OE::CNT_BENCH:
+			e.msg += "\n\n"s += getopt.show(1);
+			break;
+		case OE::NODE:
+		case OE::OPT_UNKNOWN:
+		case OE::OPT_DASH:
+		case OE::OPT_LDASH:
+		case OE::OPT_DONE:
+			e.msg += "\n\n"s += getopt.show(0);
+			break;
+		}
+		throw;
+	}
+} catch (Exception & e) {
+	if (e.msg != "") {
+		io::ferr.printf("sysfscheck: %s\n", e.msg.c_str());
+	}
+	return to_value(e.exitcode);
+} catch (...) {
+	io::ferr.print("sysfscheck: untreated failure\n");
+	return to_value(Exit::EEXCEPT);
+}
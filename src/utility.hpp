@@ -10,6 +10,13 @@
 #include <string>
 
 #include <cstdio>      /* snprintf() */
+#include <cstddef>     /* std::size_t */
+#include <limits>      /* std::numeric_limits */
+#include <utility>     /* std::pair */
+
+#ifdef __SSE2__
+#include <emmintrin.h> /* _mm_loadu_si128() etc. */
+#endif
 
 #ifndef _POWERDXX_UTILITY_HPP_
 #define _POWERDXX_UTILITY_HPP_
@@ -309,6 +316,75 @@ class Max {
  * array.
  */
 struct FromChars {
+	private:
+#ifdef __SSE2__
+	/**
+	 * Classify 16 characters as digits and whitespace.
+	 *
+	 * @param str
+	 *	The first of 16 characters to classify
+	 * @return
+	 *	A bit mask with a bit set for every digit, and a bit
+	 *	mask with a bit set for every whitespace character
+	 */
+	static std::pair<unsigned, unsigned> classify(char const * const str) {
+		auto const chars =
+		    _mm_loadu_si128(reinterpret_cast<__m128i const *>(str));
+		auto const digits =
+		    _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+		                  _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+		auto const spaces =
+		    _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+		                 _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\t' - 1)),
+		                               _mm_cmplt_epi8(chars, _mm_set1_epi8('\r' + 1))));
+		return {static_cast<unsigned>(_mm_movemask_epi8(digits)),
+		        static_cast<unsigned>(_mm_movemask_epi8(spaces))};
+	}
+#endif
+
+	/**
+	 * Skip whitespace.
+	 *
+	 * @param it,end
+	 *	The character range
+	 * @return
+	 *	The first non-whitespace character or end
+	 */
+	static char const * skip_space(char const * it, char const * const end) {
+#ifdef __SSE2__
+		for (; end - it >= 16; it += 16) {
+			auto const spaces = classify(it).second;
+			if (spaces != 0xffff) {
+				return it + __builtin_ctz(~spaces);
+			}
+		}
+#endif
+		for (; it != end && std::isspace(*it); ++it);
+		return it;
+	}
+
+	/**
+	 * Skip decimal digits.
+	 *
+	 * @param it,end
+	 *	The character range
+	 * @return
+	 *	The first non-digit character or end
+	 */
+	static char const * skip_digits(char const * it, char const * const end) {
+#ifdef __SSE2__
+		for (; end - it >= 16; it += 16) {
+			auto const digits = classify(it).first;
+			if (digits != 0xffff) {
+				return it + __builtin_ctz(~digits);
+			}
+		}
+#endif
+		for (; it != end && *it >= '0' && *it <= '9'; ++it);
+		return it;
+	}
+
+	public:
 	/**
 	 * The next character to read.
 	 */
@@ -354,6 +430,62 @@ struct FromChars {
 		return true;
 	}
 
+	/**
+	 * Retrieve a row of whitespace separated values from the array.
+	 *
+	 * Unsigned integral values are parsed in a single pass, using
+	 * SIMD to classify characters where available. Other types
+	 * are parsed value by value.
+	 *
+	 * Parsing stops when count values have been read, at the end
+	 * of the array or at the first invalid value. In the latter
+	 * case the functor points to the first character of the
+	 * invalid value, i.e. the functor equals true although fewer
+	 * than count values were read.
+	 *
+	 * @tparam T
+	 *	The value type to retrieve
+	 * @param dst
+	 *	The buffer to write the values to
+	 * @param count
+	 *	The maximum number of values to read
+	 * @return
+	 *	The number of values read
+	 */
+	template <typename T>
+	[[nodiscard]] std::size_t operator ()(T * const dst, std::size_t const count) {
+		std::size_t i = 0;
+		if constexpr (!std::is_integral_v<T> || std::is_signed_v<T> ||
+		              std::is_same_v<T, bool>) {
+			for (; i < count && (*this)(dst[i]); ++i);
+		} else {
+			if (!this->it) {
+				return 0;
+			}
+			for (auto first = this->it; i < count; ++i) {
+				auto const last = skip_digits(first, this->end);
+				if (first == last ||
+				    (last != this->end && *last && !std::isspace(*last))) {
+					break;
+				}
+				T value{0};
+				if (last - first > std::numeric_limits<T>::digits10) {
+					/* may overflow */
+					if (std::from_chars(first, last, value).ec != std::errc{}) {
+						break;
+					}
+				} else {
+					for (auto p = first; p != last; ++p) {
+						value = value * 10 + (*p - '0');
+					}
+				}
+				dst[i] = value;
+				first = this->it = skip_space(last, this->end);
+			}
+		}
+		return i;
+	}
+
 	/**
 	 * Check if unread characters remain.
 	 *
@@ -31,6 +31,9 @@ typedef uint64_t flag_t;
  */
 enum class LoadrecBits {
 	FREQ_TRACKING,  /**< Record clock frequencies per frame. */
+	DURATION_US,    /**< Record frame durations in µs instead of ms. */
+	TEMP_TRACKING,  /**< Record core temperatures per frame. */
+	ACLINE_TRACKING /**< Record the AC line state per frame. */
 };
 
 /**
@@ -51,6 +54,45 @@ constexpr flag_t operator ""_FREQ_TRACKING(unsigned long long int value) {
 	       utility::to_value(LoadrecBits::FREQ_TRACKING);
 }
 
+/**
+ * Set the DURATION_US bit.
+ *
+ * @param value
+ *	The bit value
+ * @return
+ *	The flag at the correct bit position
+ */
+constexpr flag_t operator ""_DURATION_US(unsigned long long int value) {
+	return static_cast<flag_t>(value > 0) <<
+	       utility::to_value(LoadrecBits::DURATION_US);
+}
+
+/**
+ * Set the TEMP_TRACKING bit.
+ *
+ * @param value
+ *	The bit value
+ * @return
+ *	The flag at the correct bit position
+ */
+constexpr flag_t operator ""_TEMP_TRACKING(unsigned long long int value) {
+	return static_cast<flag_t>(value > 0) <<
+	       utility::to_value(LoadrecBits::TEMP_TRACKING);
+}
+
+/**
+ * Set the ACLINE_TRACKING bit.
+ *
+ * @param value
+ *	The bit value
+ * @return
+ *	The flag at the correct bit position
+ */
+constexpr flag_t operator ""_ACLINE_TRACKING(unsigned long long int value) {
+	return static_cast<flag_t>(value > 0) <<
+	       utility::to_value(LoadrecBits::ACLINE_TRACKING);
+}
+
 } /* namespace literals */
 
 } /* namespace version */